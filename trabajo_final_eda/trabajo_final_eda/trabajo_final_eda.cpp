@@ -1,20 +1,66 @@
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <mutex>
 #include <random>
+#include <ratio>
 #include <map>
+#include <set>
+#include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
+#include <xmmintrin.h>
 using namespace std;
 
 
-#define MAX_LEVEL 1000
-const float P = 0.5;
+// valores por defecto de la altura maxima y la probabilidad de promocion; cada lista
+// los recibe como parametros de plantilla (32 niveles con P = 1/2 alcanzan para 2^32 llaves)
+#define MAX_LEVEL 32
+typedef std::ratio<1, 2> P;
+
+
+// generador de niveles: uno por hilo para que la altura de las torres no dependa
+// del orden en que los hilos llaman a rand(). seed_levels fija la secuencia
+// (semilla + numero de hilo) para poder repetir exactamente una corrida.
+thread_local std::mt19937 level_rng(std::random_device{}());
+
+void seed_levels(unsigned seed, unsigned stream = 0)
+{
+    std::seed_seq seq{ seed, stream };
+    level_rng.seed(seq);
+}
+
+// uniforme en (0, 1], nunca devuelve 0 para que log() este definido
+float frand()
+{
+    return (float)((level_rng() + 1.0) / (std::mt19937::max() + 1.0));
+}
+
+// nivel geometrico: cada nivel extra se alcanza con probabilidad Prob
+template <int MaxLevel, typename Prob>
+int random_level()
+{
+    const double p = (double)Prob::num / Prob::den;
+    int lvl = (int)(log(frand()) / log(p));
+    return lvl < MaxLevel ? lvl : MaxLevel;
+}
+
+
+// tipos de operacion sobre una lista (trazas, flat combining)
+enum trace_op_type : uint8_t { OP_ADD = 0, OP_SEARCH = 1, OP_REMOVE = 2 };
 
 
 using std::chrono::duration_cast;
@@ -25,22 +71,227 @@ using std::chrono::system_clock;
 
 
 
-template <typename T>
-class Node {
+// filtro de Bloom con contadores (admite borrados): si algun contador de la llave esta en
+// 0 la llave seguro no esta y la busqueda no necesita recorrer la lista. Los contadores son
+// de 8 bits y se quedan fijos al saturarse. Es seguro usarlo desde varios hilos.
+struct bloom_stats {
+    size_t memory;              // bytes en contadores
+    size_t counters;
+    int hashes;
+    double fill;                // fraccion de contadores distintos de 0
+    double false_positive_rate; // estimada: fill ^ hashes
+};
+
+template <typename Type>
+class counting_bloom
+{
+    size_t m;
+    int k;
+    unique_ptr<atomic<uint8_t>[]> counters;
+
+    static uint64_t mix(uint64_t x)
+    {
+        // splitmix64, para que llaves consecutivas no caigan en contadores consecutivos
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // todas las posiciones de una llave caen en el mismo bloque de 64 contadores (una
+    // linea de cache): un solo fallo de cache por consulta. Dentro del bloque se usa doble
+    // hashing, la i-esima posicion es h1 + i * h2.
+    template <typename F>
+    void positions(const Type& key, F f) const
+    {
+        uint64_t h = mix(std::hash<Type>()(key));
+        atomic<uint8_t>* block = &counters[(h % (m / 64)) * 64];
+        uint64_t h1 = (h >> 32) & 63, h2 = (h >> 38) | 1;
+        for (int i = 0; i < k; i++)
+            f(block[(h1 + i * h2) & 63]);
+    }
+
+public:
+    // ~10 contadores por llave esperada y 7 funciones dan alrededor de 1% de falsos positivos
+    explicit counting_bloom(size_t expected, int hashes = 7)
+        : m((expected * 10 + 63) / 64 * 64 + 64), k(hashes), counters(new atomic<uint8_t>[m])
+    {
+        for (size_t i = 0; i < m; i++)
+            counters[i].store(0, memory_order_relaxed);
+    }
+
+    void add(const Type& key)
+    {
+        positions(key, [](atomic<uint8_t>& c) {
+            uint8_t v = c.load(memory_order_relaxed);
+            while (v != 255 && !c.compare_exchange_weak(v, v + 1, memory_order_relaxed));
+        });
+    }
+
+    void remove(const Type& key)
+    {
+        positions(key, [](atomic<uint8_t>& c) {
+            uint8_t v = c.load(memory_order_relaxed);
+            while (v != 0 && v != 255 && !c.compare_exchange_weak(v, v - 1, memory_order_relaxed));
+        });
+    }
+
+    bool maybe_contains(const Type& key) const
+    {
+        bool all = true;
+        positions(key, [&all](const atomic<uint8_t>& c) {
+            all = all && c.load(memory_order_relaxed) != 0;
+        });
+        return all;
+    }
+
+    bloom_stats stats() const
+    {
+        size_t used = 0;
+        for (size_t i = 0; i < m; i++)
+            used += counters[i].load(memory_order_relaxed) != 0;
+        bloom_stats st;
+        st.memory = m * sizeof(atomic<uint8_t>);
+        st.counters = m;
+        st.hashes = k;
+        st.fill = (double)used / m;
+        st.false_positive_rate = pow(st.fill, k);
+        return st;
+    }
+};
+
+
+// contador repartido en franjas: cada hilo suma en la suya, en su propia linea de cache,
+// y el total solo se arma cuando alguien lo pide
+static atomic<int> stripe_next_thread(0);
+thread_local int stripe_thread = stripe_next_thread++;
+
+class striped_counter
+{
+    static const int STRIPES = 64;
+
+    struct Stripe {
+        atomic<long long> v;
+        char pad[64 - sizeof(atomic<long long>)];
+    };
+    unique_ptr<Stripe[]> stripes;
+
+public:
+    striped_counter() : stripes(new Stripe[STRIPES])
+    {
+        for (int i = 0; i < STRIPES; i++)
+            stripes[i].v.store(0, memory_order_relaxed);
+    }
+
+    void add(long long d) { stripes[stripe_thread % STRIPES].v.fetch_add(d, memory_order_relaxed); }
+
+    long long sum() const
+    {
+        long long total = 0;
+        for (int i = 0; i < STRIPES; i++)
+            total += stripes[i].v.load(memory_order_relaxed);
+        return total;
+    }
+};
+
+// bytes que ocupa una lista, por concepto
+struct memory_stats {
+    size_t nodes = 0;               // campos de los nodos (llave, banderas, versiones)
+    size_t towers = 0;              // arreglos de punteros por nivel
+    size_t locks = 0;               // un mutex por nodo
+    size_t pending_reclamation = 0; // nodos borrados que siguen enlazados por algun snapshot
+    size_t filter = 0;              // filtro de ausentes
+    size_t index = 0;               // indice congelado
+    size_t total() const { return nodes + towers + locks + pending_reclamation + filter + index; }
+};
+
+// modo TTL: cada entrada puede llevar un vencimiento (instante de steady_clock en
+// nanosegundos); desde ese instante las busquedas la tratan como ausente aunque siga
+// enlazada, hasta que el recolector la saca. TTL_NEVER es el valor de las que no vencen.
+typedef std::chrono::steady_clock ttl_clock;
+static const int64_t TTL_NEVER = numeric_limits<int64_t>::max();
+
+inline int64_t ttl_stamp(ttl_clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+// solo se lee el reloj si la entrada tiene vencimiento
+inline bool ttl_expired(int64_t expires)
+{
+    return expires != TTL_NEVER && expires <= ttl_stamp(ttl_clock::now());
+}
+
+
+static const uint64_t LIVE_VERSION = numeric_limits<uint64_t>::max();
+
+// Value del modo conteo, en las dos listas: en vez de una carga cada nodo lleva cuantas
+// veces se agrego su llave
+struct occurrence_count {};
+
+// carga del modo mapa en la lista concurrente: un shared_ptr que se reemplaza con
+// atomic_store, asi cambiar el valor de una llave no obliga a desenlazar su nodo.
+// En modo conjunto (Value = void) no ocupa lugar.
+template <typename Value>
+struct concu_payload {
+    shared_ptr<Value> payload;
+    shared_ptr<Value> load() const { return std::atomic_load(&payload); }
+    void store(shared_ptr<Value> p) { std::atomic_store(&payload, std::move(p)); }
+    // add sin carga deja el valor por defecto, como insert en la lista secuencial
+    void fresh() { store(std::make_shared<Value>()); }
+    bool present() const { return true; }
+};
+
+template <>
+struct concu_payload<void> {
+    void fresh() {}
+    bool present() const { return true; }
+};
+
+// modo conteo. El contador llega a 0 solo justo antes de borrar el nodo y desde ahi nadie
+// lo vuelve a subir: mientras tanto la llave cuenta como ausente
+template <>
+struct concu_payload<occurrence_count> {
+    atomic<size_t> occurrences;
+    concu_payload() : occurrences(1) {}
+    void fresh() { occurrences = 1; } // nodo nuevo o revivido por add: una aparicion
+    bool present() const { return occurrences.load() != 0; }
+};
+
+template <typename T, int MaxLevel = MAX_LEVEL, typename Value = void>
+class Node : public concu_payload<Value> {
 public:
     T val;
     int topLevel;
-    bool marked;
-    bool fullyLinked;
-    shared_ptr<Node<T>> levels[MAX_LEVEL + 1];
+    atomic<bool> marked;
+    atomic<bool> fullyLinked;
+    // esta en versions->retired o en la pasada de collect que lo saco de ahi; se lee y se
+    // escribe con el nodo bloqueado, asi un nodo nunca queda dos veces en la cola
+    bool queued;
+    // versiones (MVCC): el nodo es visible en la version v si v cae en [insVer, delVer)
+    // o en alguno de los intervalos anteriores guardados en history (la llave se borro
+    // y se volvio a insertar mientras un snapshot todavia la veia)
+    uint64_t insVer;
+    atomic<uint64_t> delVer;
+    vector<pair<uint64_t, uint64_t>> history;
+    atomic<int64_t> expires; // modo TTL
+    // los enlaces se leen sin candado mientras otro hilo los reescribe con el candado del
+    // predecesor: siempre pasan por next/set_next, que usan las operaciones atomicas de shared_ptr
+    shared_ptr<Node<T, MaxLevel, Value>> levels[MaxLevel + 1];
     mutex nodeMutex;
-    Node(int k) : val(k), topLevel(MAX_LEVEL), marked(false), fullyLinked(false),
-        nodeMutex() {
+    shared_ptr<Node<T, MaxLevel, Value>> next(int level) const {
+        return std::atomic_load(&levels[level]);
+    }
+    void set_next(int level, shared_ptr<Node<T, MaxLevel, Value>> n) {
+        std::atomic_store(&levels[level], std::move(n));
+    }
+    Node(int k) : val(k), topLevel(MaxLevel), marked(false), fullyLinked(false), queued(false),
+        insVer(0), delVer(LIVE_VERSION), expires(TTL_NEVER), nodeMutex() {
         for (int i = 0; i < topLevel; i++)
             levels[i] = nullptr;
     }
-    Node(T x, int level) : val(x), topLevel(level), marked(false), fullyLinked(false),
-        nodeMutex() {
+    Node(T x, int level) : val(x), topLevel(level), marked(false), fullyLinked(false), queued(false),
+        insVer(0), delVer(LIVE_VERSION), expires(TTL_NEVER), nodeMutex() {
         for (int i = 0; i < topLevel; i++)
             levels[i] = nullptr;
     }
@@ -54,30 +305,67 @@ public:
 
 
 
-template <typename T>
+template <typename T, int MaxLevel = MAX_LEVEL, typename Prob = P, typename Value = void>
 class skipList_concu {
+    static_assert(MaxLevel > 0, "MaxLevel debe ser positivo");
+    static_assert(Prob::num > 0 && Prob::num < Prob::den, "Prob debe estar en (0, 1)");
+
+    std::shared_ptr<Node<T, MaxLevel, Value>> head;
+    std::shared_ptr<Node<T, MaxLevel, Value>> tail;
+
+    // reloj de versiones y snapshots activos, compartidos por todas las copias de la lista.
+    // Solo snapshot() avanza el reloj; add y remove solo lo leen para sellar sus nodos, asi
+    // no escriben ninguna variable compartida. oldest es la version del snapshot mas viejo.
+    struct Versions {
+        atomic<uint64_t> clock;
+        atomic<uint64_t> oldest;
+        mutex m;
+        multiset<uint64_t> active;
+        vector<shared_ptr<Node<T, MaxLevel, Value>>> retired; // borrados que algun snapshot aun ve
+        atomic<size_t> retained; // borrados que siguen enlazados: sin revivir ni recoger
+        Versions() : clock(0), oldest(LIVE_VERSION), retained(0) {}
+    };
+    std::shared_ptr<Versions> versions;
+
+    // elementos vivos y nodos enlazados (incluye borrados retenidos), por franjas
+    struct Counters {
+        striped_counter elements;
+        striped_counter nodes;
+    };
+    std::shared_ptr<Counters> counters;
+
+    // filtro opcional de llaves ausentes (ver enable_filter). Tambien es estado compartido:
+    // las copias que guardan el ejecutor, el recolector y los snapshots ven el mismo filtro.
+    // Un filtro reemplazado no se libera hasta que muere la lista, porque otro hilo puede
+    // estar consultandolo.
+    struct Filter {
+        atomic<counting_bloom<T>*> bloom;
+        mutex m;
+        vector<unique_ptr<counting_bloom<T>>> owned;
+        Filter() : bloom(nullptr) {}
+    };
+    std::shared_ptr<Filter> filters;
 
-    std::shared_ptr<Node<T>> head;
-    std::shared_ptr<Node<T>> tail;
+    counting_bloom<T>* filter() const {
+        return filters->bloom.load(memory_order_acquire);
+    }
 
     inline unsigned randomLevel() {
-        int l = 0;
-        while (static_cast <float> (rand()) / static_cast <float> (RAND_MAX) <= 0.5) {
-            l++;
-        }
-        return l > MAX_LEVEL ? MAX_LEVEL : l;
+        return random_level<MaxLevel, Prob>();
     }
 
-    inline int find(int k, shared_ptr<Node<T>> preds[], shared_ptr<Node<T>> succs[]) {
+    // las centinelas se reconocen por identidad y no por llave: una llave igual a
+    // numeric_limits<T>::max() es una llave mas y la cola queda siempre despues de todas
+    inline int find(int k, shared_ptr<Node<T, MaxLevel, Value>> preds[], shared_ptr<Node<T, MaxLevel, Value>> succs[]) {
         int lFound = -1;
-        std::shared_ptr<Node<T>> pred = head;
-        for (int layer = MAX_LEVEL; layer >= 0; layer--) {
-            std::shared_ptr<Node<T>> curr = pred->levels[layer];
-            while (k > curr->val) {
+        std::shared_ptr<Node<T, MaxLevel, Value>> pred = head;
+        for (int layer = MaxLevel; layer >= 0; layer--) {
+            std::shared_ptr<Node<T, MaxLevel, Value>> curr = pred->next(layer);
+            while (curr != tail && k > curr->val) {
                 pred = curr;
-                curr = pred->levels[layer];
+                curr = pred->next(layer);
             }
-            if (lFound == -1 and k == curr->val) {
+            if (lFound == -1 and curr != tail and k == curr->val) {
                 lFound = layer;
             }
             preds[layer] = pred;
@@ -86,38 +374,486 @@ class skipList_concu {
         return lFound;
     }
 
-    bool okToDelete(std::shared_ptr<Node<T>> candidate, int lFound) {
+    bool okToDelete(std::shared_ptr<Node<T, MaxLevel, Value>> candidate, int lFound) {
         return (candidate->fullyLinked and candidate->topLevel == lFound and !candidate->marked);
     }
 
+    bool isLive(const std::shared_ptr<Node<T, MaxLevel, Value>>& n) {
+        return n->fullyLinked and !n->marked and n->delVer == LIVE_VERSION and !ttl_expired(n->expires) and n->present();
+    }
+
+    // la version mas vieja que algun snapshot todavia puede leer
+    uint64_t horizon() {
+        return versions->oldest.load();
+    }
+
+    // nodo vivo con la llave, nullptr si no esta
+    std::shared_ptr<Node<T, MaxLevel, Value>> lookup(T key) {
+        if (filter() && !filter()->maybe_contains(key))
+            return nullptr;
+        // como find pero sin guardar predecesores, y se para en el nivel mas alto del nodo
+        std::shared_ptr<Node<T, MaxLevel, Value>> pred = head;
+        for (int layer = MaxLevel; layer >= 0; layer--) {
+            std::shared_ptr<Node<T, MaxLevel, Value>> curr = pred->next(layer);
+            while (curr != tail && key > curr->val) {
+                pred = curr;
+                curr = pred->next(layer);
+            }
+            if (curr != tail && key == curr->val)
+                return isLive(curr) ? curr : nullptr;
+        }
+        return nullptr;
+    }
+
+    bool visibleAt(const std::shared_ptr<Node<T, MaxLevel, Value>>& n, uint64_t v) {
+        lock_guard<mutex> guard(n->nodeMutex);
+        if (!n->fullyLinked)
+            return false;
+        if (n->insVer <= v && v < n->delVer)
+            return true;
+        for (auto const& h : n->history) {
+            if (h.first <= v && v < h.second)
+                return true;
+        }
+        return false;
+    }
+
+    // desenlaza un nodo ya marcado y bloqueado; preds/succs vienen de una busqueda
+    // previa y se recalculan si dejaron de ser validos. Libera el bloqueo del nodo.
+    void unlink(std::shared_ptr<Node<T, MaxLevel, Value>> nodeToDelete,
+        shared_ptr<Node<T, MaxLevel, Value>> preds[], shared_ptr<Node<T, MaxLevel, Value>> succs[]) {
+        int topLevel = nodeToDelete->topLevel;
+        while (true) {
+            map<shared_ptr<Node<T, MaxLevel, Value>>, int> locked_nodes;
+            shared_ptr<Node<T, MaxLevel, Value>> pred;
+            bool valid = true;
+
+            for (int level = 0; valid && level <= topLevel; level++) {
+                pred = preds[level];
+                if (!(locked_nodes.count(pred))) {
+                    pred->lock();
+                    locked_nodes.insert(make_pair(pred, 1));
+                }
+                valid = !pred->marked && pred->next(level) == nodeToDelete;
+            }
+            if (!valid) {
+                for (auto const& x : locked_nodes) {
+                    x.first->unlock();
+                }
+                find(nodeToDelete->val, preds, succs);
+                continue;
+            }
+            for (int level = topLevel; level >= 0; level--) {
+                preds[level]->set_next(level, nodeToDelete->next(level)); // los dereferenciamos
+            }
+            counters->nodes.add(-1);
+            nodeToDelete->unlock();
+            for (auto const& x : locked_nodes) { // desbloquemos todo
+                x.first->unlock();
+            }
+            return;
+        }
+    }
+
+    // borra un nodo vivo ya bloqueado: si algun snapshot anterior al borrado todavia lo ve
+    // se queda enlazado, si no se desenlaza. Libera el bloqueo; true si lo desenlazo.
+    bool erase(std::shared_ptr<Node<T, MaxLevel, Value>> nodeToDelete,
+        shared_ptr<Node<T, MaxLevel, Value>> preds[], shared_ptr<Node<T, MaxLevel, Value>> succs[]) {
+        uint64_t v = versions->clock.load();
+        nodeToDelete->delVer = v;
+        counters->elements.add(-1);
+        if (filter())
+            filter()->remove(nodeToDelete->val);
+        // snapshot() sube el reloj despues de registrarse, asi que un snapshot que todavia
+        // no estaba en oldest tiene version >= v y no ve este nodo: si oldest >= v se desenlaza
+        // sin tocar el candado. Si no, la decision se toma bajo versions->m, en la misma seccion
+        // que el push: entre mirar oldest y entrar el snapshot pudo cerrarse y collect() ya pudo
+        // haber vaciado retired, y el nodo quedaria retenido sin nadie que lo recoja.
+        if (versions->oldest.load() < v) {
+            lock_guard<mutex> guard(versions->m);
+            if (!versions->active.empty() && *versions->active.begin() < v) {
+                // si se revivio y se volvio a borrar antes de que collect lo viera, ya esta en la cola
+                if (!nodeToDelete->queued)
+                    versions->retired.push_back(nodeToDelete);
+                nodeToDelete->queued = true;
+                versions->retained++;
+                nodeToDelete->unlock();
+                return false;
+            }
+        }
+        nodeToDelete->marked = true;
+        unlink(nodeToDelete, preds, succs);
+        return true;
+    }
+
+    // desenlaza los nodos borrados que ya ningun snapshot puede ver
+    void collect() {
+        vector<shared_ptr<Node<T, MaxLevel, Value>>> pending;
+        uint64_t oldest;
+        {
+            lock_guard<mutex> guard(versions->m);
+            pending.swap(versions->retired);
+            oldest = versions->active.empty() ? LIVE_VERSION : *versions->active.begin();
+        }
+        std::shared_ptr<Node<T, MaxLevel, Value>> preds[MaxLevel + 1];
+        std::shared_ptr<Node<T, MaxLevel, Value>> succs[MaxLevel + 1];
+        vector<shared_ptr<Node<T, MaxLevel, Value>>> keep;
+        for (auto& n : pending) {
+            n->lock();
+            if (n->marked || n->delVer == LIVE_VERSION) { // ya desenlazado o reinsertado
+                n->queued = false;
+                n->unlock();
+                continue;
+            }
+            if (n->delVer > oldest) {
+                n->unlock();
+                keep.push_back(n);
+                continue;
+            }
+            n->queued = false;
+            n->marked = true;
+            versions->retained--;
+            find(n->val, preds, succs);
+            unlink(n, preds, succs);
+        }
+        if (!keep.empty()) {
+            lock_guard<mutex> guard(versions->m);
+            versions->retired.insert(versions->retired.end(), keep.begin(), keep.end());
+        }
+    }
+
+    void release(uint64_t v) {
+        {
+            lock_guard<mutex> guard(versions->m);
+            versions->active.erase(versions->active.find(v));
+            versions->oldest = versions->active.empty() ? LIVE_VERSION : *versions->active.begin();
+        }
+        collect();
+    }
+
 public:
     skipList_concu() {
-        head = std::make_shared<Node<T>>(INT_MIN, MAX_LEVEL);
-        tail = std::make_shared<Node<T>>(INT_MIN, MAX_LEVEL);
-        for (int i = 0; i < MAX_LEVEL; i++) {
-            head->levels[i] = tail;
+        head = std::make_shared<Node<T, MaxLevel, Value>>(numeric_limits<T>::min(), MaxLevel);
+        tail = std::make_shared<Node<T, MaxLevel, Value>>(numeric_limits<T>::max(), MaxLevel);
+        for (int i = 0; i <= MaxLevel; i++) {
+            head->set_next(i, tail);
+        }
+        head->fullyLinked = tail->fullyLinked = true;
+        versions = std::make_shared<Versions>();
+        counters = std::make_shared<Counters>();
+        filters = std::make_shared<Filter>();
+    };
+
+    // vista de solo lectura del conjunto tal como estaba en la version en que se creo.
+    // Mientras exista, los nodos que ella todavia ve no se desenlazan. Los vencimientos
+    // no cuentan: una entrada vencida sigue visible hasta que se borra o se reinserta.
+    class Snapshot {
+        skipList_concu list; // copia barata: comparte nodos y versiones
+        uint64_t ver;
+
+    public:
+        Snapshot(const skipList_concu& l, uint64_t v) : list(l), ver(v) {}
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        ~Snapshot() { list.release(ver); }
+
+        uint64_t version() const { return ver; }
+
+        bool contains(T key) {
+            std::shared_ptr<Node<T, MaxLevel, Value>> preds[MaxLevel + 1];
+            std::shared_ptr<Node<T, MaxLevel, Value>> succs[MaxLevel + 1];
+            list.find(key, preds, succs);
+            return succs[0] != list.tail && succs[0]->val == key && list.visibleAt(succs[0], ver);
+        }
+
+        // llama f(llave) en orden para cada llave visible en [lo, hi]
+        template <typename F>
+        void scan(T lo, T hi, F f) {
+            std::shared_ptr<Node<T, MaxLevel, Value>> preds[MaxLevel + 1];
+            std::shared_ptr<Node<T, MaxLevel, Value>> succs[MaxLevel + 1];
+            list.find(lo, preds, succs);
+            for (auto curr = succs[0]; curr != list.tail && curr->val <= hi; curr = curr->next(0)) {
+                if (list.visibleAt(curr, ver))
+                    f(curr->val);
+            }
+        }
+
+        vector<T> range(T lo, T hi) {
+            vector<T> out;
+            scan(lo, hi, [&out](const T& k) { out.push_back(k); });
+            return out;
         }
     };
 
+    // ve los nodos sellados con version <= v; lo que se selle despues ya lee v + 1
+    std::shared_ptr<Snapshot> snapshot() {
+        lock_guard<mutex> guard(versions->m);
+        uint64_t v = versions->clock.load();
+        versions->active.insert(v);
+        versions->oldest = *versions->active.begin();
+        versions->clock = v + 1;
+        return std::make_shared<Snapshot>(*this, v);
+    }
+
+    // arma el filtro con las llaves actuales; llamarla antes de empezar a usar la lista
+    // desde varios hilos
+    void enable_filter(size_t expected) {
+        unique_ptr<counting_bloom<T>> f(new counting_bloom<T>(expected));
+        for (auto curr = head->next(0); curr != tail; curr = curr->next(0)) {
+            if (isLive(curr))
+                f->add(curr->val);
+        }
+        lock_guard<mutex> guard(filters->m);
+        filters->bloom.store(f.get(), memory_order_release);
+        filters->owned.push_back(std::move(f));
+    }
+
+    bloom_stats filter_stats() {
+        return filter() ? filter()->stats() : bloom_stats();
+    }
+
     bool add(T x) {
+        return add(x, TTL_NEVER);
+    }
+
+    // modo TTL: la entrada deja de verse en el instante expires. Como en un conjunto, si la
+    // llave sigue viva add devuelve false y no cambia nada, tampoco el vencimiento
+    bool add(T x, ttl_clock::time_point expires) {
+        return add(x, ttl_stamp(expires));
+    }
+
+    // renueva el vencimiento de una llave viva; time_point::max() se lo quita.
+    // false si la llave no esta o ya vencio
+    bool expire_at(T x, ttl_clock::time_point expires) {
+        auto node = lookup(x);
+        if (!node)
+            return false;
+        node->lock(); // asi no se cruza con reap, que decide bajo el mismo candado
+        bool live = isLive(node);
+        if (live)
+            node->expires = ttl_stamp(expires);
+        node->unlock();
+        return live;
+    }
+
+    // modo mapa (Value != void). Se devuelven shared_ptr y no referencias: si otro hilo
+    // reemplaza el valor, quien ya tenia el anterior lo sigue usando sin riesgo.
+    // try_emplace construye la carga solo si la llave no estaba.
+    template <typename V = Value, typename... Args>
+    std::pair<std::shared_ptr<V>, bool> try_emplace(T key, Args&&... args) {
+        return emplace_at<V>(key, TTL_NEVER, std::forward<Args>(args)...);
+    }
+
+    // modo mapa con TTL: como try_emplace, pero la entrada nueva vence en expires. Si la
+    // llave sigue viva no se toca, tampoco su vencimiento
+    template <typename V = Value, typename... Args>
+    std::pair<std::shared_ptr<V>, bool> try_emplace_until(T key, ttl_clock::time_point expires, Args&&... args) {
+        return emplace_at<V>(key, ttl_stamp(expires), std::forward<Args>(args)...);
+    }
+
+    // como la llave va aparte, emplace tampoco construye nada si la llave ya esta
+    template <typename V = Value, typename... Args>
+    std::pair<std::shared_ptr<V>, bool> emplace(T key, Args&&... args) {
+        return try_emplace<V>(key, std::forward<Args>(args)...);
+    }
+
+    // si la llave esta, cambia su valor de una vez sin tocar el nodo; true si la inserto
+    template <typename U>
+    std::pair<std::shared_ptr<Value>, bool> insert_or_assign(T key, U&& v) {
+        auto p = std::make_shared<Value>(std::forward<U>(v));
+        while (true) {
+            if (auto n = lookup(key)) {
+                n->store(p);
+                return std::make_pair(p, false);
+            }
+            if (add(key, TTL_NEVER, [&p](Node<T, MaxLevel, Value>& n) { n.store(p); }))
+                return std::make_pair(p, true);
+        }
+    }
+
+    // valor de la llave, nullptr si no esta. Solo en modo mapa
+    template <typename V = Value>
+    typename std::enable_if<!std::is_void<V>::value, std::shared_ptr<V>>::type get(T key) {
+        auto n = lookup(key);
+        return n ? n->load() : nullptr;
+    }
+
+    // modo conteo (Value = occurrence_count): cada llave es un solo nodo con su contador.
+    // Si la llave ya esta, sumar es una busqueda sin candados y un compare-and-swap sobre
+    // el contador; solo la primera aparicion pasa por add. Devuelve el contador nuevo.
+    // add cuenta una aparicion y remove borra la llave con todas sus apariciones.
+    size_t increment(T key, size_t n = 1) {
+        static_assert(std::is_same<Value, occurrence_count>::value, "increment es del modo conteo");
+        if (n == 0) // sin esto se insertaria una llave con contador 0, que nadie borra
+            return occurrences(key);
+        while (true) {
+            if (auto node = lookup(key)) {
+                size_t c = node->occurrences.load();
+                // en 0 el nodo se esta borrando: se espera a que salga y se agrega de nuevo
+                while (c > 0 && !node->occurrences.compare_exchange_weak(c, c + n));
+                if (c > 0)
+                    return c + n;
+                this_thread::yield();
+                continue;
+            }
+            // el nodo nuevo nace con las n apariciones
+            if (add(key, TTL_NEVER, [n](Node<T, MaxLevel, Value>& node) { node.occurrences = n; }))
+                return n;
+        }
+    }
+
+    // resta n apariciones; la que deja el contador en 0 desenlaza el nodo. Devuelve lo
+    // que queda (0 tambien si la llave no estaba)
+    size_t decrement(T key, size_t n = 1) {
+        static_assert(std::is_same<Value, occurrence_count>::value, "decrement es del modo conteo");
+        std::shared_ptr<Node<T, MaxLevel, Value>> preds[MaxLevel + 1];
+        std::shared_ptr<Node<T, MaxLevel, Value>> succs[MaxLevel + 1];
+        int lFound = find(key, preds, succs);
+        if (lFound == -1 || !isLive(succs[lFound]))
+            return 0;
+        std::shared_ptr<Node<T, MaxLevel, Value>> node = succs[lFound];
+        size_t c = node->occurrences.load();
+        while (c > 0 && !node->occurrences.compare_exchange_weak(c, c > n ? c - n : 0));
+        if (c > n)
+            return c - n;
+        if (c == 0)
+            return 0; // otro hilo ya lo estaba borrando
+        node->lock();
+        // si mientras tanto vencio y alguien lo revivio, ya no es nuestro
+        if (node->marked || node->delVer != LIVE_VERSION || node->occurrences != 0) {
+            node->unlock();
+            return 0;
+        }
+        erase(node, preds, succs);
+        return 0;
+    }
+
+    // apariciones de la llave, 0 si no esta
+    size_t occurrences(T key) {
+        static_assert(std::is_same<Value, occurrence_count>::value, "occurrences es del modo conteo");
+        auto node = lookup(key);
+        return node ? node->occurrences.load() : 0;
+    }
+
+    // saca del nivel 0 los vencidos entre los proximos `visit` nodos a partir de la llave
+    // from, y deja en from donde seguir (el minimo al llegar al final). Los vencidos
+    // seguidos comparten los predecesores, asi una racha se desenlaza con una sola busqueda.
+    size_t reap(T& from, size_t visit) {
+        std::shared_ptr<Node<T, MaxLevel, Value>> preds[MaxLevel + 1];
+        std::shared_ptr<Node<T, MaxLevel, Value>> succs[MaxLevel + 1];
+        find(from, preds, succs);
+        size_t reaped = 0;
+        auto curr = succs[0];
+        for (; curr != tail && visit > 0; curr = curr->next(0), visit--) {
+            bool unlinked = false;
+            if (curr->fullyLinked && ttl_expired(curr->expires)) {
+                curr->lock();
+                if (!curr->marked && curr->delVer == LIVE_VERSION && ttl_expired(curr->expires)) {
+                    unlinked = erase(curr, preds, succs);
+                    reaped++;
+                }
+                else {
+                    curr->unlock();
+                }
+            }
+            if (!unlinked) {
+                for (int level = 0; level <= curr->topLevel; level++)
+                    preds[level] = curr;
+            }
+        }
+        from = curr == tail ? numeric_limits<T>::min() : curr->val;
+        return reaped;
+    }
+
+private:
+    template <typename V, typename... Args>
+    std::pair<std::shared_ptr<V>, bool> emplace_at(T key, int64_t expires, Args&&... args) {
+        std::shared_ptr<V> p;
+        while (true) {
+            if (auto n = lookup(key))
+                return std::make_pair(n->load(), false);
+            // la carga se arma recien cuando la insercion gana: si otro hilo mete la llave
+            // primero, los argumentos quedan sin tocar
+            if (add(key, expires, [&](Node<T, MaxLevel, Value>& n) { n.store(p = std::make_shared<V>(std::forward<Args>(args)...)); }))
+                return std::make_pair(p, true);
+        }
+    }
+
+    bool add(T x, int64_t expires) {
+        return add(x, expires, [](Node<T, MaxLevel, Value>& n) { n.fresh(); });
+    }
+
+    // init(nodo) arma la carga del modo mapa o el contador del modo conteo; se llama una
+    // sola vez y solo si la insercion gana, con el nodo nuevo o revivido todavia bloqueado
+    template <typename F>
+    bool add(T x, int64_t expires, F init) {
+        // la llave entra al filtro antes de ser visible, y sale si al final no se inserto
+        counting_bloom<T>* f = filter();
+        if (f)
+            f->add(x);
+        bool added = insert(x, expires, init);
+        if (f && !added)
+            f->remove(x);
+        return added;
+    }
+
+    template <typename F>
+    bool insert(T x, int64_t expires, F& init) {
         int topLevel = randomLevel();
-        std::shared_ptr<Node<T>> preds[MAX_LEVEL + 1];
-        std::shared_ptr<Node<T>> succs[MAX_LEVEL + 1];
+        std::shared_ptr<Node<T, MaxLevel, Value>> preds[MaxLevel + 1];
+        std::shared_ptr<Node<T, MaxLevel, Value>> succs[MaxLevel + 1];
 
         while (true) {
             //buscamos el valor y guardamos sus predecesores y antecesores
             int  lFound = find(x, preds, succs);
             if (lFound != -1) {
-                std::shared_ptr<Node<T>> nodeFound = succs[lFound];
+                std::shared_ptr<Node<T, MaxLevel, Value>> nodeFound = succs[lFound];
                 if (!nodeFound->marked) {
                     while (!nodeFound->fullyLinked);
+                    if (nodeFound->delVer == LIVE_VERSION && !ttl_expired(nodeFound->expires)) {
+                        if (nodeFound->present())
+                            return false;
+                        // modo conteo: el contador llego a 0 y decrement lo esta borrando
+                        this_thread::yield();
+                        continue;
+                    }
+                    // borrado pero retenido por un snapshot, o vencido: se revive el mismo nodo
+                    nodeFound->lock();
+                    if (nodeFound->marked) {
+                        nodeFound->unlock();
+                        continue;
+                    }
+                    bool expired = nodeFound->delVer == LIVE_VERSION && ttl_expired(nodeFound->expires);
+                    if (nodeFound->delVer != LIVE_VERSION || expired) {
+                        uint64_t oldest = horizon();
+                        uint64_t v = versions->clock.load();
+                        uint64_t end = expired ? v : nodeFound->delVer.load();
+                        auto& h = nodeFound->history;
+                        h.erase(std::remove_if(h.begin(), h.end(),
+                            [oldest](const pair<uint64_t, uint64_t>& e) { return e.second <= oldest; }), h.end());
+                        if (end > oldest)
+                            h.push_back(make_pair(nodeFound->insVer, end));
+                        nodeFound->insVer = v;
+                        nodeFound->delVer = LIVE_VERSION;
+                        nodeFound->expires = expires;
+                        init(*nodeFound);
+                        nodeFound->unlock();
+                        if (!expired) {
+                            versions->retained--; // sigue en la cola, collect lo saltea
+                            counters->elements.add(1);
+                        }
+                        else if (filter())
+                            filter()->remove(x); // la llave ya estaba en el filtro
+                        return true;
+                    }
+                    nodeFound->unlock();
                     return false;
                 }
                 continue;
             }
 
-            map<shared_ptr<Node<T>>, int> locked_nodes;
-            std::shared_ptr<Node<T>> pred, succ, prevPred = nullptr;
+            map<shared_ptr<Node<T, MaxLevel, Value>>, int> locked_nodes;
+            std::shared_ptr<Node<T, MaxLevel, Value>> pred, succ, prevPred = nullptr;
             bool valid = true;
             int layer_count = topLevel + 1;
 
@@ -131,7 +867,7 @@ public:
                     locked_nodes.insert(make_pair(pred, 1));
                 }
                 // confirmamos que sea valido el lugar para insertar el nodo
-                valid = !(pred->marked) && !(succ->marked) && (pred->levels[level] == succ);
+                valid = !(pred->marked) && !(succ->marked) && (pred->next(level) == succ);
             }
             if (!valid) {
                 for (auto const& x : locked_nodes) {
@@ -141,17 +877,24 @@ public:
             }
 
             //creamos el nuevo nodo y lo insertamos 
-            auto newNode = std::make_shared<Node<T>>(x, topLevel);
+            auto newNode = std::make_shared<Node<T, MaxLevel, Value>>(x, topLevel);
+            newNode->expires = expires;
+            init(*newNode);
+            newNode->lock(); // los snapshots que lo encuentren esperan a que tenga version
             for (int level = 0; level <= topLevel; level++) {
-                newNode->levels[level] = succs[level];
+                newNode->set_next(level, succs[level]);
             }
 
             for (int level = 0; level <= topLevel; level++) {
-                preds[level]->levels[level] = newNode;
+                preds[level]->set_next(level, newNode);
             }
 
             // marcamos como que esta vinculado
+            newNode->insVer = versions->clock.load();
             newNode->fullyLinked = true;
+            newNode->unlock();
+            counters->nodes.add(1);
+            counters->elements.add(1);
 
             // desbloqueamos los threads restantes
             for (auto const& x : locked_nodes) {
@@ -162,85 +905,50 @@ public:
         }
     }
 
+public:
     bool remove(int key) {
-        std::shared_ptr<Node<T>> nodeToDelete = nullptr;
-        bool isMarked = false;
-        int topLevel = -1;
-        std::shared_ptr<Node<T>> preds[MAX_LEVEL + 1];
-        std::shared_ptr<Node<T>> succs[MAX_LEVEL + 1];
-        for (size_t i = 0; i < preds.size(); i++) {
-            preds[i] = NULL;
-            succs[i] = NULL;
-        }
-        while (true) {
-            int lFound = find(key, preds, succs);
-            if (lFound != -1) {
-                nodeToDelete = succs[lFound];
-            }
-            if (isMarked || (lFound != -1 && okToDelete(succs[lFound], lFound))) {
-                if (!isMarked) {
-                    topLevel = nodeToDelete->topLevel;
-                    nodeToDelete->lock();
-                    if (nodeToDelete->marked) {
-                        nodeToDelete->unlock();
-                        return false;
-                    }
-                    nodeToDelete->marked = true;
-                    isMarked = true;
-                }
-                map<shared_ptr<Node<T>>, int> locked_nodes;
-                shared_ptr<Node<T>> pred, succ, prevPred = nullptr;
-                bool valid = true;
-
-                for (int level = 0; valid && level <= topLevel; level++) {
-                    pred = preds[level];
-                    if (!(locked_nodes.count(pred))) {
-                        pred->lock();
-                        locked_nodes.insert(make_pair(pred, 1));
-                    }
-                    valid = !pred->marked && pred->levels[level] == nodeToDelete;
-                }
-                if (!valid) {
-                    for (auto const& x : locked_nodes) {
-                        x.first->unlock();
-                    }
-                    continue;
-                }
-                for (int level = topLevel; level >= 0; level--) {
-                    preds[level]->levels[level] = nodeToDelete->levels[level]; // los dereferenciamos
-                }
-                nodeToDelete->unlock();
-                for (auto const& x : locked_nodes) { // desbloquemos todo
-                    x.first->unlock();
-                }
-                return true; // si existe
-            }
-            else
-                return false; // si no existe
+        std::shared_ptr<Node<T, MaxLevel, Value>> preds[MaxLevel + 1];
+        std::shared_ptr<Node<T, MaxLevel, Value>> succs[MaxLevel + 1];
+        int lFound = find(key, preds, succs);
+        if (lFound == -1 || !okToDelete(succs[lFound], lFound))
+            return false; // si no existe
+        std::shared_ptr<Node<T, MaxLevel, Value>> nodeToDelete = succs[lFound];
+        nodeToDelete->lock();
+        // con el contador en 0 ya lo esta borrando decrement
+        if (nodeToDelete->marked || nodeToDelete->delVer != LIVE_VERSION || !nodeToDelete->present()) {
+            nodeToDelete->unlock();
+            return false;
         }
+        // una entrada vencida se borra igual, pero para quien llama ya no existia
+        bool expired = ttl_expired(nodeToDelete->expires);
+        erase(nodeToDelete, preds, succs);
+        return !expired; // si existe
     }
 
     bool search(int val) {
 
-        std::shared_ptr<Node<T>> curr = head;
+        if (filter() && !filter()->maybe_contains(val))
+            return false;
+
+        std::shared_ptr<Node<T, MaxLevel, Value>> curr = head;
 
-        for (int level = MAX_LEVEL; level >= 0; level--) {
-            while (curr->levels[level] != NULL && val >= curr->levels[level]->val) {
-                if (val == curr->levels[level]->val) {
-                    return true;
+        for (int level = MaxLevel; level >= 0; level--) {
+            for (auto next = curr->next(level); next != tail && val >= next->val; next = curr->next(level)) {
+                if (val == next->val) {
+                    return isLive(next);
                 }
-                curr = curr->levels[level];
+                curr = next;
             }
-            if (val == curr->val) {
-                return true;
+            if (val == curr->val && curr != head) {
+                return isLive(curr);
             }
         }
 
-        curr = curr->levels[0];
+        curr = curr->next(0);
 
-        if ((curr != NULL) && (curr->val == val)) {
+        if ((curr != tail) && (curr->val == val)) {
 
-            return true;
+            return isLive(curr);
         }
         else {
 
@@ -248,184 +956,1982 @@ public:
         }
     }
 
-    bool empty() { return head->levels[0] == tail; }
+    // suma de las franjas: exacta cuando no hay escrituras en curso. Incluye las entradas
+    // vencidas que el recolector todavia no saco.
+    size_t size() {
+        long long n = counters->elements.sum();
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    // estimacion en O(1) a partir de los contadores (sin el bloque de control de shared_ptr)
+    memory_stats memory() {
+        long long linked = counters->nodes.sum();
+        size_t n = (linked > 0 ? (size_t)linked : 0) + 2; // mas cabeza y cola
+        size_t retained = versions->retained.load();
+        if (retained > n - 2)
+            retained = n - 2;
+        const size_t towerBytes = sizeof(shared_ptr<Node<T, MaxLevel, Value>>) * (MaxLevel + 1);
+        const size_t fieldBytes = sizeof(Node<T, MaxLevel, Value>) - towerBytes - sizeof(mutex);
+        memory_stats st;
+        st.nodes = (n - retained) * fieldBytes;
+        st.towers = (n - retained) * towerBytes;
+        st.locks = (n - retained) * sizeof(mutex);
+        st.pending_reclamation = retained * sizeof(Node<T, MaxLevel, Value>);
+        st.filter = filter() ? filter()->stats().memory : 0;
+        return st;
+    }
+
+    bool empty() {
+        // puede haber nodos borrados que siguen enlazados porque un snapshot los ve
+        for (auto curr = head->next(0); curr != tail; curr = curr->next(0)) {
+            if (isLive(curr))
+                return false;
+        }
+        return true;
+    }
 };
 
 
 
-template <typename Type>
+template <typename Type, typename Value = void>
 struct node
 {
     Type value;
     node** levels;
-    node(int level, Type& value)
+    int height;    // nivel mas alto en el que esta enlazado
+    int base;      // nivel sorteado al insertar, el modo adaptativo nunca baja de aqui
+    unsigned hits; // accesos recientes (modo adaptativo)
+    int64_t expires; // modo TTL
+    node(int level, const Type& value)
     {
         levels = new node * [level + 1];
         memset(levels, 0, sizeof(node*) * (level + 1));
         this->value = value;
+        height = base = level;
+        hits = 0;
+        expires = TTL_NEVER;
     }
 
 
 };
 
+// nodo de datos de la lista secuencial: la carga del modo mapa se construye dentro del
+// nodo, y solo aqui; la cabecera es un node pelado, asi Value no necesita constructor por
+// defecto. En modo conjunto (Value = void) no agrega nada
+template <typename Type, typename Value>
+struct payload_node : node<Type, Value>
+{
+    Value payload;
+    template <typename... Args>
+    payload_node(int level, const Type& value, Args&&... args)
+        : node<Type, Value>(level, value), payload(std::forward<Args>(args)...) {}
+};
 
 template <typename Type>
-struct skiplist_secuen
+struct payload_node<Type, void> : node<Type, void>
 {
-    node<Type>* header;
-    Type value;
-    int level;
-    skiplist_secuen()
-    {
-        header = new node<Type>(MAX_LEVEL, value);
-        level = 0;
-    }
+    payload_node(int level, const Type& value) : node<Type, void>(level, value) {}
+};
 
+// modo conteo: en vez de carga, cuantas veces se agrego la llave
+template <typename Type>
+struct payload_node<Type, occurrence_count> : node<Type, occurrence_count>
+{
+    size_t occurrences;
+    payload_node(int level, const Type& value) : node<Type, occurrence_count>(level, value), occurrences(1) {}
+};
 
-    void print();
 
-    Type get(Type val);
+// indice inmutable para la fase de solo lectura: las llaves ordenadas se guardan en orden
+// Eytzinger (arbol binario implicito en un arreglo, hijos de k en 2k y 2k+1), asi los
+// primeros niveles de cualquier busqueda comparten las mismas lineas de cache y la
+// busqueda no tiene saltos impredecibles
+template <typename Type>
+class eytzinger_index
+{
+    vector<Type> keys; // keys[0] no se usa
+    size_t n;
 
-    void insert(Type val);
+    void build(const vector<Type>& sorted, size_t& i, size_t k)
+    {
+        if (k > n)
+            return;
+        build(sorted, i, 2 * k);
+        keys[k] = sorted[i++];
+        build(sorted, i, 2 * k + 1);
+    }
 
-    void delete_(Type val);
+public:
+    explicit eytzinger_index(const vector<Type>& sorted) : keys(sorted.size() + 1), n(sorted.size())
+    {
+        size_t i = 0;
+        build(sorted, i, 1);
+    }
 
-};
+    size_t size() const { return n; }
 
+    size_t memory() const { return keys.capacity() * sizeof(Type); }
 
-float frand()
+    // posicion de la primera llave >= val, 0 si no hay
+    size_t lower_bound_pos(Type val) const
+    {
+        size_t k = 1;
+        while (k <= n)
+        {
+            _mm_prefetch((const char*)(keys.data() + std::min(16 * k, n)), _MM_HINT_T0);
+            k = 2 * k + (keys[k] < val);
+        }
+        // se bajo a la derecha desde el final del camino: subir mientras k sea hijo derecho
+        while (k & 1)
+            k >>= 1;
+        return k >> 1;
+    }
+
+    // siguiente posicion en orden, 0 al terminar
+    size_t next(size_t k) const
+    {
+        if (2 * k + 1 <= n)
+        {
+            k = 2 * k + 1;
+            while (2 * k <= n)
+                k = 2 * k;
+            return k;
+        }
+        while (k & 1)
+            k >>= 1;
+        return k >> 1;
+    }
+
+    size_t first() const
+    {
+        size_t k = n > 0 ? 1 : 0;
+        while (k != 0 && 2 * k <= n)
+            k = 2 * k;
+        return k;
+    }
+
+    const Type& at(size_t k) const { return keys[k]; }
+
+    bool contains(Type val) const
+    {
+        size_t k = lower_bound_pos(val);
+        return k != 0 && keys[k] == val;
+    }
+
+    void to_sorted(vector<Type>& out) const
+    {
+        out.clear();
+        out.reserve(n);
+        for (size_t k = first(); k != 0; k = next(k))
+            out.push_back(keys[k]);
+    }
+};
+
+
+template <typename Type, int MaxLevel = MAX_LEVEL, typename Prob = P, typename Value = void>
+struct skiplist_secuen
+{
+    static_assert(MaxLevel > 0, "MaxLevel debe ser positivo");
+    static_assert(Prob::num > 0 && Prob::num < Prob::den, "Prob debe estar en (0, 1)");
+
+    node<Type, Value>* header;
+    int level;
+
+    // modo adaptativo: las llaves consultadas seguido suben de nivel y vuelven a
+    // bajar cuando se enfrian; cada adapt_period accesos los contadores se dividen a la mitad
+    bool adaptive;
+    unsigned accesses;
+    unsigned adapt_period;
+    static const unsigned MIN_ADAPT_PERIOD = 1 << 14;
+
+    // modo congelado: mientras no sea NULL las llaves viven solo en este indice y la
+    // lista de nodos esta vacia
+    unique_ptr<eytzinger_index<Type>> frozen;
+
+    // filtro opcional de llaves ausentes, NULL si no se pidio
+    unique_ptr<counting_bloom<Type>> filter;
+
+    size_t count;       // llaves en la lista (incluye las vencidas sin recolectar)
+    size_t tower_slots; // punteros de nivel reservados en los nodos (sin la cabecera)
+
+    // modo TTL: entradas con vencimiento, y recoleccion repartida entre las inserciones y
+    // borrados (cada uno revisa a lo sumo reap_budget nodos a partir de reap_from)
+    size_t expiring;
+    size_t reap_budget;
+    Type reap_from;
+    bool reap_started;
+
+    skiplist_secuen()
+    {
+        header = new node<Type, Value>(MaxLevel, Type());
+        level = 0;
+        adaptive = false;
+        accesses = 0;
+        adapt_period = MIN_ADAPT_PERIOD;
+        count = 0;
+        tower_slots = 0;
+        expiring = 0;
+        reap_budget = 0;
+        reap_from = Type();
+        reap_started = false;
+    }
+
+    // la lista es duena de sus nodos: no se copia, una copia compartiria la cabecera
+    skiplist_secuen(const skiplist_secuen&) = delete;
+    skiplist_secuen& operator=(const skiplist_secuen&) = delete;
+
+    ~skiplist_secuen();
+
+    size_t size() const { return count; }
+
+    memory_stats memory() const;
+
+    void set_adaptive(bool on) { adaptive = on; }
+
+    // arma un filtro con las llaves actuales; desde ahi las busquedas de llaves ausentes
+    // casi nunca recorren la lista
+    void enable_filter(size_t expected);
+
+    bloom_stats filter_stats() { return filter ? filter->stats() : bloom_stats(); }
+
+
+    void print();
+
+    Type get(Type val);
+
+    // igual que get pero sin imprimir, devuelve NULL si no existe (o si esta congelada)
+    node<Type, Value>* find(Type val);
+
+    bool contains(Type val);
+
+    // primera llave >= val, NULL si no hay; el puntero vale hasta la siguiente modificacion
+    const Type* lower_bound(Type val);
+
+    // llama f(llave) en orden para cada llave en [lo, hi]
+    template <typename F>
+    void scan(Type lo, Type hi, F f);
+
+    vector<Type> range(Type lo, Type hi);
+
+    // compacta la lista en un eytzinger_index y libera los nodos; thaw la reconstruye.
+    // Cualquier insercion o borrado descongela primero. El indice no guarda vencimientos,
+    // cargas ni contadores: mientras haya entradas que vencen, o en modo mapa o conteo,
+    // no se congela y devuelve false. true si la lista quedo congelada.
+    bool freeze();
+
+    void thaw();
+
+    void insert(Type val);
+
+    // modo TTL: la entrada deja de verse en el instante expires. Si la llave sigue viva no
+    // se toca, tampoco su vencimiento; para renovarlo esta expire_at
+    void insert(Type val, ttl_clock::time_point expires);
+
+    // cambia el vencimiento de una llave viva; time_point::max() se lo quita.
+    // false si la llave no esta o ya vencio
+    bool expire_at(const Type& key, ttl_clock::time_point expires);
+
+    void delete_(Type val);
+
+    // saca los vencidos entre los proximos `visit` nodos del recorrido circular del nivel 0;
+    // una racha de vencidos se desenlaza en la misma pasada, sin volver a buscar
+    size_t reap(size_t visit);
+
+    // cuantos nodos revisa reap en cada insert o delete_ (0 la apaga)
+    void set_reap_budget(size_t visit) { reap_budget = visit; }
+
+    // modo mapa (Value != void): la carga se construye dentro del nodo y se devuelve por
+    // referencia, valida hasta que se borre la llave. try_emplace construye la carga
+    // solo si la llave no estaba.
+    template <typename V = Value, typename... Args>
+    std::pair<V&, bool> try_emplace(const Type& key, Args&&... args);
+
+    // como la llave va aparte, emplace tampoco construye nada si la llave ya esta
+    template <typename V = Value, typename... Args>
+    std::pair<V&, bool> emplace(const Type& key, Args&&... args)
+    {
+        return try_emplace<V>(key, std::forward<Args>(args)...);
+    }
+
+    template <typename U, typename V = Value>
+    std::pair<V&, bool> insert_or_assign(const Type& key, U&& v);
+
+    // NULL si no esta
+    Value* find_value(const Type& key);
+
+    // modo conteo (Value = occurrence_count): cada llave es un solo nodo con su contador
+    // de apariciones; el nodo se borra cuando el contador llega a 0. increment y
+    // decrement devuelven el contador nuevo; insert cuenta una aparicion de una llave
+    // nueva y delete_ borra la llave con todas sus apariciones.
+    size_t increment(const Type& key, size_t n = 1);
+
+    size_t decrement(const Type& key, size_t n = 1);
+
+    size_t occurrences(const Type& key);
+
+    // operaciones con dedo: finger guarda los predecesores de la ultima llave tocada y la
+    // siguiente busqueda parte de ahi. Sirven para aplicar un lote ordenado por llave en
+    // una sola pasada; finger_reset lo deja apuntando a la cabecera.
+    void finger_reset(node<Type, Value>* finger[]);
+
+    bool finger_find(Type val, node<Type, Value>* finger[]);
+
+    bool finger_insert(Type val, node<Type, Value>* finger[], int64_t expires = TTL_NEVER);
+
+    bool finger_delete(Type val, node<Type, Value>* finger[]);
+
+private:
+    void finger_advance(Type val, node<Type, Value>* finger[]);
+
+    // crea y engancha un nodo nuevo; finger ya tiene los predecesores de val
+    template <typename... Args>
+    payload_node<Type, Value>* link(const Type& val, node<Type, Value>* finger[], int64_t expires, Args&&... args);
+
+    // todos los nodos menos la cabecera son payload_node; se borran por su tipo real
+    static payload_node<Type, Value>* data(node<Type, Value>* x)
+    {
+        return static_cast<payload_node<Type, Value>*>(x);
+    }
+
+    // nodo sin carga para thaw. Solo el modo conjunto se congela, y en los demas modos
+    // Value puede no tener constructor por defecto: ahi nunca se llama
+    static node<Type, Value>* unfrozen(int lvl, const Type& key, std::true_type)
+    {
+        return new payload_node<Type, Value>(lvl, key);
+    }
+
+    static node<Type, Value>* unfrozen(int, const Type&, std::false_type)
+    {
+        return NULL;
+    }
+
+    // modo conteo: un nodo vencido que se reusa vuelve a una aparicion
+    static void recount(payload_node<Type, occurrence_count>* x)
+    {
+        x->occurrences = 1;
+    }
+
+    template <typename N>
+    static void recount(N*)
+    {
+    }
+
+    // desenlaza y libera x; finger tiene sus predecesores
+    void unlink(node<Type, Value>* x, node<Type, Value>* finger[]);
+
+    int target_height(node<Type, Value>* x);
+
+    void touch(node<Type, Value>* x, node<Type, Value>* update[]);
+
+    void raise(node<Type, Value>* x, node<Type, Value>* update[], int h);
+
+    void cool();
+
+};
+
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+skiplist_secuen<Type, MaxLevel, Prob, Value>::~skiplist_secuen()
+{
+    node<Type, Value>* x = header->levels[0];
+    while (x != NULL)
+    {
+        node<Type, Value>* next = x->levels[0];
+        delete[] x->levels;
+        delete data(x);
+        x = next;
+    }
+    delete[] header->levels;
+    delete header;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::finger_reset(node<Type, Value>* finger[])
+{
+    thaw(); // todas las operaciones con dedo trabajan sobre los nodos
+    for (int i = 0; i <= MaxLevel; i++)
+        finger[i] = header;
+}
+
+// deja en finger los predecesores de val en cada nivel. Cada nivel arranca desde lo que
+// quedo en finger (o desde el nodo que trae el nivel de arriba si ese va mas adelante),
+// asi una secuencia creciente de llaves recorre la lista una sola vez.
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::finger_advance(Type val, node<Type, Value>* finger[])
+{
+    node<Type, Value>* x = header;
+    for (int i = level; i >= 0; i--)
+    {
+        if (finger[i] != header && (x == header || x->value < finger[i]->value))
+            x = finger[i];
+        while (x->levels[i] != NULL && x->levels[i]->value < val)
+        {
+            x = x->levels[i];
+        }
+        finger[i] = x;
+    }
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::enable_filter(size_t expected)
+{
+    filter.reset(new counting_bloom<Type>(expected));
+    if (frozen)
+    {
+        for (size_t k = frozen->first(); k != 0; k = frozen->next(k))
+            filter->add(frozen->at(k));
+        return;
+    }
+    for (node<Type, Value>* x = header->levels[0]; x != NULL; x = x->levels[0])
+        filter->add(x->value);
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+bool skiplist_secuen<Type, MaxLevel, Prob, Value>::finger_find(Type val, node<Type, Value>* finger[])
+{
+    if (filter && !filter->maybe_contains(val))
+        return false; // el dedo sigue valido para la siguiente llave
+    finger_advance(val, finger);
+    node<Type, Value>* x = finger[0]->levels[0];
+    return x != NULL && x->value == val && !ttl_expired(x->expires);
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+bool skiplist_secuen<Type, MaxLevel, Prob, Value>::finger_insert(Type val, node<Type, Value>* finger[], int64_t expires)
+{
+    finger_advance(val, finger);
+    node<Type, Value>* x = finger[0]->levels[0];
+    if (x != NULL && x->value == val)
+    {
+        if (!ttl_expired(x->expires))
+            return false;
+        // vencida pero sin recolectar: se reusa el nodo
+        expiring -= x->expires != TTL_NEVER;
+        expiring += expires != TTL_NEVER;
+        x->expires = expires;
+        recount(data(x));
+        return true;
+    }
+    link(val, finger, expires);
+    return true;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+template <typename... Args>
+payload_node<Type, Value>* skiplist_secuen<Type, MaxLevel, Prob, Value>::link(const Type& val, node<Type, Value>* finger[],
+    int64_t expires, Args&&... args)
+{
+    int lvl = random_level<MaxLevel, Prob>();
+    if (lvl > level)
+    {
+        for (int i = level + 1; i <= lvl; i++)
+        {
+            finger[i] = header;
+        }
+        level = lvl;
+    }
+    payload_node<Type, Value>* x = new payload_node<Type, Value>(lvl, val, std::forward<Args>(args)...);
+    x->expires = expires;
+    for (int i = 0; i <= lvl; i++)
+    {
+        x->levels[i] = finger[i]->levels[i];
+        finger[i]->levels[i] = x;
+    }
+    if (filter)
+        filter->add(val);
+    count++;
+    tower_slots += lvl + 1;
+    expiring += expires != TTL_NEVER;
+    return x;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+template <typename V, typename... Args>
+std::pair<V&, bool> skiplist_secuen<Type, MaxLevel, Prob, Value>::try_emplace(const Type& key, Args&&... args)
+{
+    node<Type, Value>* update[MaxLevel + 1];
+    finger_reset(update);
+    finger_advance(key, update);
+    node<Type, Value>* x = update[0]->levels[0];
+    if (x != NULL && x->value == key)
+    {
+        if (!ttl_expired(x->expires))
+            return std::pair<V&, bool>(data(x)->payload, false);
+        finger_delete(key, update); // vencida: su carga no se reusa
+    }
+    payload_node<Type, Value>* added = link(key, update, TTL_NEVER, std::forward<Args>(args)...);
+    if (reap_budget > 0)
+        reap(reap_budget);
+    return std::pair<V&, bool>(added->payload, true);
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+template <typename U, typename V>
+std::pair<V&, bool> skiplist_secuen<Type, MaxLevel, Prob, Value>::insert_or_assign(const Type& key, U&& v)
+{
+    node<Type, Value>* update[MaxLevel + 1];
+    finger_reset(update);
+    finger_advance(key, update);
+    node<Type, Value>* x = update[0]->levels[0];
+    if (x != NULL && x->value == key)
+    {
+        if (!ttl_expired(x->expires))
+        {
+            data(x)->payload = std::forward<U>(v);
+            return std::pair<V&, bool>(data(x)->payload, false);
+        }
+        finger_delete(key, update);
+    }
+    payload_node<Type, Value>* added = link(key, update, TTL_NEVER, std::forward<U>(v));
+    if (reap_budget > 0)
+        reap(reap_budget);
+    return std::pair<V&, bool>(added->payload, true);
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+Value* skiplist_secuen<Type, MaxLevel, Prob, Value>::find_value(const Type& key)
+{
+    node<Type, Value>* x = find(key);
+    return x != NULL ? &data(x)->payload : NULL;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+size_t skiplist_secuen<Type, MaxLevel, Prob, Value>::increment(const Type& key, size_t n)
+{
+    static_assert(std::is_same<Value, occurrence_count>::value, "increment es del modo conteo");
+    if (n == 0)
+        return occurrences(key);
+    node<Type, Value>* update[MaxLevel + 1];
+    finger_reset(update);
+    finger_advance(key, update);
+    node<Type, Value>* x = update[0]->levels[0];
+    if (x != NULL && x->value == key)
+    {
+        if (!ttl_expired(x->expires))
+            return data(x)->occurrences += n;
+        finger_delete(key, update); // vencida: se cuenta desde cero
+    }
+    link(key, update, TTL_NEVER)->occurrences = n;
+    if (reap_budget > 0)
+        reap(reap_budget);
+    return n;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+size_t skiplist_secuen<Type, MaxLevel, Prob, Value>::decrement(const Type& key, size_t n)
+{
+    static_assert(std::is_same<Value, occurrence_count>::value, "decrement es del modo conteo");
+    // una sola bajada: si el contador llega a 0 el nodo se desenlaza con los mismos predecesores
+    node<Type, Value>* update[MaxLevel + 1];
+    finger_reset(update);
+    finger_advance(key, update);
+    node<Type, Value>* x = update[0]->levels[0];
+    if (x == NULL || x->value != key || ttl_expired(x->expires))
+        return 0;
+    if (data(x)->occurrences > n)
+        return data(x)->occurrences -= n;
+    unlink(x, update);
+    if (reap_budget > 0)
+        reap(reap_budget);
+    return 0;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+size_t skiplist_secuen<Type, MaxLevel, Prob, Value>::occurrences(const Type& key)
+{
+    static_assert(std::is_same<Value, occurrence_count>::value, "occurrences es del modo conteo");
+    node<Type, Value>* x = find(key);
+    return x != NULL ? data(x)->occurrences : 0;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+bool skiplist_secuen<Type, MaxLevel, Prob, Value>::finger_delete(Type val, node<Type, Value>* finger[])
+{
+    finger_advance(val, finger);
+    node<Type, Value>* x = finger[0]->levels[0];
+    if (x == NULL || x->value != val)
+        return false;
+
+    // una entrada vencida se borra igual, pero para quien llama ya no existia
+    bool expired = ttl_expired(x->expires);
+    unlink(x, finger);
+    return !expired;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::unlink(node<Type, Value>* x, node<Type, Value>* finger[])
+{
+    for (int i = 0; i <= level; i++)
+    {
+        if (finger[i]->levels[i] != x)
+            break;
+        finger[i]->levels[i] = x->levels[i];
+    }
+    count--;
+    tower_slots -= x->height + 1;
+    expiring -= x->expires != TTL_NEVER;
+    if (filter)
+        filter->remove(x->value);
+    delete[] x->levels;
+    delete data(x);
+    while (level > 0 && header->levels[level] == NULL)
+    {
+        level--;
+    }
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::insert(Type val)
+{
+    node<Type, Value>* update[MaxLevel + 1];
+    finger_reset(update);
+    finger_insert(val, update);
+    if (reap_budget > 0)
+        reap(reap_budget);
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::insert(Type val, ttl_clock::time_point expires)
+{
+    node<Type, Value>* update[MaxLevel + 1];
+    finger_reset(update);
+    finger_insert(val, update, ttl_stamp(expires));
+    if (reap_budget > 0)
+        reap(reap_budget);
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+bool skiplist_secuen<Type, MaxLevel, Prob, Value>::expire_at(const Type& key, ttl_clock::time_point expires)
+{
+    node<Type, Value>* update[MaxLevel + 1];
+    finger_reset(update);
+    finger_advance(key, update);
+    node<Type, Value>* x = update[0]->levels[0];
+    if (x == NULL || x->value != key || ttl_expired(x->expires))
+        return false;
+    int64_t stamp = ttl_stamp(expires);
+    expiring -= x->expires != TTL_NEVER;
+    expiring += stamp != TTL_NEVER;
+    x->expires = stamp;
+    return true;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::delete_(Type val)
+{
+    node<Type, Value>* update[MaxLevel + 1];
+    finger_reset(update);
+    finger_delete(val, update);
+    if (reap_budget > 0)
+        reap(reap_budget);
+}
+
+// last[i] es siempre el ultimo nodo que queda en el nivel i antes de x, asi que sacar x es
+// enganchar last[i] con su sucesor en cada nivel de su torre
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+size_t skiplist_secuen<Type, MaxLevel, Prob, Value>::reap(size_t visit)
+{
+    if (frozen || expiring == 0)
+        return 0;
+    node<Type, Value>* last[MaxLevel + 1];
+    for (int i = 0; i <= MaxLevel; i++)
+        last[i] = header;
+    if (reap_started)
+        finger_advance(reap_from, last);
+
+    int64_t now = ttl_stamp(ttl_clock::now());
+    size_t reaped = 0;
+    node<Type, Value>* x = last[0]->levels[0];
+    for (; x != NULL && visit > 0; visit--)
+    {
+        node<Type, Value>* next = x->levels[0];
+        if (x->expires <= now)
+        {
+            for (int i = 0; i <= x->height; i++)
+                last[i]->levels[i] = x->levels[i];
+            if (filter)
+                filter->remove(x->value);
+            count--;
+            tower_slots -= x->height + 1;
+            expiring--;
+            delete[] x->levels;
+            delete data(x);
+            reaped++;
+        }
+        else
+        {
+            for (int i = 0; i <= x->height; i++)
+                last[i] = x;
+        }
+        x = next;
+    }
+    reap_started = x != NULL;
+    if (x != NULL)
+        reap_from = x->value;
+    while (level > 0 && header->levels[level] == NULL)
+        level--;
+    return reaped;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::print()
+{
+    cout << "\n*****Skip List*****" << "\n";
+    if (frozen)
+    {
+        cout << "Congelada: ";
+        for (size_t k = frozen->first(); k != 0; k = frozen->next(k))
+            cout << frozen->at(k) << " ";
+        cout << "\n";
+        return;
+    }
+    for (int i = 0; i <= level; i++)
+    {
+        node<Type, Value>* node = header->levels[i];
+        cout << "Nivel " << i << ": ";
+        while (node != NULL)
+        {
+            cout << node->value << " ";
+            node = node->levels[i];
+        }
+        cout << "\n";
+    }
+};
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+node<Type, Value>* skiplist_secuen<Type, MaxLevel, Prob, Value>::find(Type val)
+{
+    if (frozen)
+        return NULL;
+    if (filter && !filter->maybe_contains(val))
+        return NULL;
+    node<Type, Value>* x = header;
+    node<Type, Value>* update[MaxLevel + 1];
+    for (int i = level; i >= 0; i--)
+    {
+        while (x->levels[i] != NULL && x->levels[i]->value <= val)
+        {
+            if (x->levels[i]->value == val) {
+                if (ttl_expired(x->levels[i]->expires))
+                    return NULL;
+                // se encuentra en su nivel mas alto, update ya tiene los predecesores de arriba
+                if (adaptive)
+                    touch(x->levels[i], update);
+                return x->levels[i];
+            }
+            x = x->levels[i];
+        }
+        update[i] = x;
+    }
+    return NULL;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+bool skiplist_secuen<Type, MaxLevel, Prob, Value>::contains(Type val)
+{
+    if (frozen)
+        return (!filter || filter->maybe_contains(val)) && frozen->contains(val);
+    return find(val) != NULL;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+const Type* skiplist_secuen<Type, MaxLevel, Prob, Value>::lower_bound(Type val)
+{
+    if (frozen)
+    {
+        size_t k = frozen->lower_bound_pos(val);
+        return k != 0 ? &frozen->at(k) : NULL;
+    }
+    node<Type, Value>* x = header;
+    for (int i = level; i >= 0; i--)
+    {
+        while (x->levels[i] != NULL && x->levels[i]->value < val)
+        {
+            x = x->levels[i];
+        }
+    }
+    x = x->levels[0];
+    while (x != NULL && ttl_expired(x->expires))
+        x = x->levels[0];
+    return x != NULL ? &x->value : NULL;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+template <typename F>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::scan(Type lo, Type hi, F f)
+{
+    if (frozen)
+    {
+        for (size_t k = frozen->lower_bound_pos(lo); k != 0 && !(hi < frozen->at(k)); k = frozen->next(k))
+            f(frozen->at(k));
+        return;
+    }
+    node<Type, Value>* x = header;
+    for (int i = level; i >= 0; i--)
+    {
+        while (x->levels[i] != NULL && x->levels[i]->value < lo)
+        {
+            x = x->levels[i];
+        }
+    }
+    int64_t now = expiring > 0 ? ttl_stamp(ttl_clock::now()) : numeric_limits<int64_t>::min();
+    for (x = x->levels[0]; x != NULL && !(hi < x->value); x = x->levels[0])
+    {
+        if (x->expires > now)
+            f(x->value);
+    }
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+vector<Type> skiplist_secuen<Type, MaxLevel, Prob, Value>::range(Type lo, Type hi)
 {
-    return (float)rand() / RAND_MAX;
+    vector<Type> out;
+    scan(lo, hi, [&out](const Type& k) { out.push_back(k); });
+    return out;
 }
 
-int random_level()
-{
-    static bool first = true;
-    if (first)
-    {
-        srand((unsigned)time(NULL));
-        first = false;
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+bool skiplist_secuen<Type, MaxLevel, Prob, Value>::freeze()
+{
+    if (frozen)
+        return true;
+    if (expiring > 0 || !std::is_void<Value>::value)
+        return false;
+    vector<Type> sorted;
+    node<Type, Value>* x = header->levels[0];
+    while (x != NULL)
+    {
+        node<Type, Value>* next = x->levels[0];
+        sorted.push_back(x->value);
+        delete[] x->levels;
+        delete data(x);
+        x = next;
+    }
+    memset(header->levels, 0, sizeof(node<Type, Value>*) * (MaxLevel + 1));
+    level = 0;
+    tower_slots = 0;
+    frozen.reset(new eytzinger_index<Type>(sorted));
+    return true;
+}
+
+// reconstruye la lista en O(n) enganchando cada llave detras del ultimo nodo de cada nivel
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::thaw()
+{
+    if (!frozen)
+        return;
+    vector<Type> sorted;
+    frozen->to_sorted(sorted);
+    frozen.reset();
+
+    node<Type, Value>* last[MaxLevel + 1];
+    for (int i = 0; i <= MaxLevel; i++)
+        last[i] = header;
+    for (size_t j = 0; j < sorted.size(); j++)
+    {
+        int lvl = random_level<MaxLevel, Prob>();
+        if (lvl > level)
+            level = lvl;
+        node<Type, Value>* x = unfrozen(lvl, sorted[j], std::is_void<Value>());
+        for (int i = 0; i <= lvl; i++)
+        {
+            last[i]->levels[i] = x;
+            last[i] = x;
+        }
+        tower_slots += lvl + 1;
+    }
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+memory_stats skiplist_secuen<Type, MaxLevel, Prob, Value>::memory() const
+{
+    memory_stats st;
+    st.nodes = sizeof(node<Type, Value>); // la cabecera
+    if (!frozen)
+        st.nodes += count * sizeof(payload_node<Type, Value>);
+    st.towers = (tower_slots + MaxLevel + 1) * sizeof(node<Type, Value>*);
+    st.filter = filter ? filter->stats().memory : 0;
+    st.index = frozen ? frozen->memory() : 0;
+    return st;
+}
+
+// una llave que recibe la fraccion f de los accesos merece la altura que tendria si
+// la lista tuviera f * n llaves: level - log_{1/p}(1/f). Con los contadores divididos
+// a la mitad cada adapt_period accesos, f ~ hits / (2 * adapt_period).
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+int skiplist_secuen<Type, MaxLevel, Prob, Value>::target_height(node<Type, Value>* x)
+{
+    const double p = (double)Prob::num / Prob::den;
+    double f = x->hits / (2.0 * adapt_period);
+    int h = f >= 1 ? level : level - (int)(log(f) / log(p));
+    if (h < x->base)
+        h = x->base;
+    return h < MaxLevel ? h : MaxLevel;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::touch(node<Type, Value>* x, node<Type, Value>* update[])
+{
+    x->hits++;
+    if (++accesses >= adapt_period) {
+        cool();
+        return;
+    }
+    // solo se recalcula la altura cuando hits llega a una potencia de 2
+    if ((x->hits & (x->hits - 1)) == 0) {
+        int h = target_height(x);
+        if (h > x->height)
+            raise(x, update, h);
+    }
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::raise(node<Type, Value>* x, node<Type, Value>* update[], int h)
+{
+    if (h > level)
+    {
+        for (int i = level + 1; i <= h; i++)
+        {
+            update[i] = header;
+        }
+        level = h;
+    }
+    node<Type, Value>** grown = new node<Type, Value>* [h + 1];
+    memcpy(grown, x->levels, sizeof(node<Type, Value>*) * (x->height + 1));
+    for (int i = x->height + 1; i <= h; i++)
+    {
+        grown[i] = update[i]->levels[i];
+        update[i]->levels[i] = x;
+    }
+    delete[] x->levels;
+    x->levels = grown;
+    tower_slots += h - x->height;
+    x->height = h;
+}
+
+// enfria los contadores y baja las torres que ya no se justifican, en una sola pasada por el nivel 0
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+void skiplist_secuen<Type, MaxLevel, Prob, Value>::cool()
+{
+    node<Type, Value>* last[MaxLevel + 1];
+    for (int i = 0; i <= MaxLevel; i++)
+        last[i] = header;
+    unsigned n = 0;
+    for (node<Type, Value>* x = header->levels[0]; x != NULL; x = x->levels[0], n++)
+    {
+        x->hits >>= 1;
+        int h = x->hits ? target_height(x) : x->base;
+        for (int i = h + 1; i <= x->height; i++)
+            last[i]->levels[i] = x->levels[i];
+        if (h < x->height)
+        {
+            node<Type, Value>** shrunk = new node<Type, Value>* [h + 1];
+            memcpy(shrunk, x->levels, sizeof(node<Type, Value>*) * (h + 1));
+            delete[] x->levels;
+            x->levels = shrunk;
+            tower_slots -= x->height - h;
+            x->height = h;
+        }
+        for (int i = 0; i <= x->height; i++)
+            last[i] = x;
+    }
+    while (level > 0 && header->levels[level] == NULL)
+        level--;
+    accesses = 0;
+    adapt_period = 4 * n > MIN_ADAPT_PERIOD ? 4 * n : MIN_ADAPT_PERIOD;
+}
+
+template <typename Type, int MaxLevel, typename Prob, typename Value>
+Type skiplist_secuen<Type, MaxLevel, Prob, Value>::get(Type val)
+{
+    if (contains(val)) {
+        cout << "Si existe el nodo " << val << endl;
+        return val;
+    }
+    else {
+        cout << "No existe el nodo " << val << endl;
+        return -1;
+    };
+}
+
+
+// ============================================================== SKIP LIST CON FLAT COMBINING =================================================================================
+
+// Envoltura concurrente de skiplist_secuen: cada hilo deja su operacion en su propia casilla
+// y el hilo que consigue el candado de combinador aplica todas las pendientes, ordenadas por
+// llave, en una sola pasada con dedo. Los resultados vuelven por las mismas casillas.
+// Conviene cuando muchos hilos escriben sobre pocas llaves y los bloqueos finos de
+// skipList_concu se la pasan fallando la validacion.
+
+// Casillas que tomo este hilo, una por lista. Cuando el hilo termina las devuelve a las
+// listas que sigan vivas, asi los hilos nuevos las reutilizan en vez de quedarse sin casilla.
+struct fc_claims {
+    struct Claim {
+        const void* table;
+        weak_ptr<void> alive;
+        atomic<bool>* taken;
+        int slot;
+    };
+    vector<Claim> claims;
+    ~fc_claims() {
+        for (auto& c : claims) {
+            shared_ptr<void> table = c.alive.lock(); // la lista no se destruye mientras devolvemos
+            if (table)
+                c.taken->store(false, memory_order_release);
+        }
+    }
+    static fc_claims& local() {
+        static thread_local fc_claims mine;
+        return mine;
+    }
+};
+
+template <typename Type, int MaxLevel = MAX_LEVEL, typename Prob = P>
+class skiplist_fc {
+    enum { EMPTY = 0, PENDING = 1, DONE = 2 };
+
+    struct Slot {
+        atomic<bool> taken; // algun hilo vivo la tiene
+        atomic<int> state;
+        uint8_t op;
+        Type key;
+        bool result;
+        char pad[64]; // cada casilla en su propia linea de cache
+        Slot() : taken(false), state(EMPTY), op(0), key(), result(false) {}
+    };
+
+    // las casillas viven aparte para que los hilos puedan saber si la lista ya no existe
+    struct Table {
+        vector<unique_ptr<Slot>> slots;
+    };
+
+    skiplist_secuen<Type, MaxLevel, Prob> list;
+    shared_ptr<Table> table;
+    mutex combiner;
+
+    // casilla de este hilo en esta lista; la primera vez toma una libre. -1 si estan todas
+    // ocupadas por hilos vivos
+    int my_slot() {
+        vector<fc_claims::Claim>& claims = fc_claims::local().claims;
+        for (auto& c : claims) {
+            if (c.table == table.get() && !c.alive.expired())
+                return c.slot;
+        }
+        for (int i = 0; i < (int)table->slots.size(); i++) {
+            bool expected = false;
+            if (table->slots[i]->taken.compare_exchange_strong(expected, true)) {
+                // de paso se olvidan las casillas de listas ya destruidas
+                claims.erase(std::remove_if(claims.begin(), claims.end(),
+                    [](const fc_claims::Claim& c) { return c.alive.expired(); }), claims.end());
+                fc_claims::Claim c = { table.get(), table, &table->slots[i]->taken, i };
+                claims.push_back(c);
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool apply(node<Type>* finger[], uint8_t op, Type key) {
+        switch (op) {
+        case OP_ADD: return list.finger_insert(key, finger);
+        case OP_REMOVE: return list.finger_delete(key, finger);
+        default: return list.finger_find(key, finger);
+        }
+    }
+
+    void combine() {
+        vector<Slot*> batch;
+        for (auto& s : table->slots) {
+            if (s->state.load(memory_order_acquire) == PENDING)
+                batch.push_back(s.get());
+        }
+        std::stable_sort(batch.begin(), batch.end(), [](Slot* a, Slot* b) { return a->key < b->key; });
+        node<Type>* finger[MaxLevel + 1];
+        list.finger_reset(finger);
+        for (Slot* s : batch) {
+            s->result = apply(finger, s->op, s->key);
+            s->state.store(DONE, memory_order_release);
+        }
+    }
+
+    bool execute(uint8_t op, Type key) {
+        int mine = my_slot();
+        if (mine < 0) { // mas hilos vivos que casillas: se aplica sola
+            lock_guard<mutex> guard(combiner);
+            node<Type>* finger[MaxLevel + 1];
+            list.finger_reset(finger);
+            return apply(finger, op, key);
+        }
+        Slot& s = *table->slots[mine];
+        s.op = op;
+        s.key = key;
+        s.state.store(PENDING, memory_order_release);
+        while (s.state.load(memory_order_acquire) != DONE) {
+            if (combiner.try_lock()) {
+                combine();
+                combiner.unlock();
+            }
+            else {
+                this_thread::yield();
+            }
+        }
+        s.state.store(EMPTY, memory_order_relaxed);
+        return s.result;
+    }
+
+public:
+    // max_threads: cuantos hilos vivos a la vez pueden tener casilla propia
+    explicit skiplist_fc(int max_threads = 64) : table(make_shared<Table>()) {
+        for (int i = 0; i < max_threads; i++)
+            table->slots.emplace_back(new Slot());
+    }
+
+    bool add(Type x) { return execute(OP_ADD, x); }
+
+    bool search(Type x) { return execute(OP_SEARCH, x); }
+
+    bool remove(Type x) { return execute(OP_REMOVE, x); }
+};
+
+
+// ============================================================== SKIP LIST SIN PUNTOS CALIENTES =================================================================================
+
+// Variante "contention-friendly" (Crain, Gramoli y Raynal): las escrituras solo tocan el
+// nivel 0 y bloquean a lo mas dos nodos; borrar es solo marcar. Un hilo de mantenimiento
+// sube y baja torres para que cada nivel tenga mas o menos la mitad de nodos del de abajo,
+// saca del indice los nodos borrados y luego los desenlaza del nivel 0. Asi los nodos
+// altos cerca de la cabecera no se vuelven un cuello de botella.
+
+template <typename T, int MaxLevel = MAX_LEVEL>
+class NodeCF {
+public:
+    T val;
+    int height;             // solo lo toca el hilo de mantenimiento
+    atomic<bool> deleted;   // borrado logico
+    atomic<bool> removed;   // ya desenlazado del nivel 0
+    // el hilo de mantenimiento reescribe el indice sin candados mientras los demas lo
+    // recorren: los enlaces solo se tocan con next/set_next (operaciones atomicas de shared_ptr)
+    shared_ptr<NodeCF<T, MaxLevel>> levels[MaxLevel + 1];
+    mutex nodeMutex;
+    NodeCF(T x) : val(x), height(0), deleted(false), removed(false), nodeMutex() {}
+    shared_ptr<NodeCF<T, MaxLevel>> next(int level) const {
+        return std::atomic_load(&levels[level]);
+    }
+    void set_next(int level, shared_ptr<NodeCF<T, MaxLevel>> n) {
+        std::atomic_store(&levels[level], std::move(n));
+    }
+    void lock() {
+        nodeMutex.lock();
+    }
+    void unlock() {
+        nodeMutex.unlock();
+    }
+};
+
+// que tan atrasado va el indice respecto del nivel 0, medido en cada pasada
+struct cf_stats {
+    size_t data_nodes = 0;      // nodos enlazados en el nivel 0, incluidos los borrados pendientes
+    size_t pending_removal = 0; // borrados logicamente que siguen enlazados
+    size_t unindexed = 0;       // nodos del nivel 0 que el nivel 1 deberia cubrir y todavia no cubre
+    int index_height = 0;       // niveles de indice en uso
+    size_t passes = 0;
+};
+
+template <typename T, int MaxLevel = MAX_LEVEL>
+class skipList_cf {
+    static_assert(MaxLevel > 0, "MaxLevel debe ser positivo");
+
+    std::shared_ptr<NodeCF<T, MaxLevel>> head;
+    std::shared_ptr<NodeCF<T, MaxLevel>> tail;
+
+    // mantenimiento
+    std::chrono::microseconds interval;
+    size_t max_unindexed;
+    cf_stats last;
+    mutex statsMutex;
+    mutex wakeMutex;
+    condition_variable wake;
+    bool stopping;
+    atomic<bool> dirty; // hubo escrituras desde la ultima pasada
+    std::thread maintainer;
+
+    // avisa al hilo de mantenimiento; solo la primera escritura despues de una pasada toma el candado
+    void touched() {
+        if (!dirty.exchange(true)) {
+            lock_guard<mutex> guard(wakeMutex);
+            wake.notify_one();
+        }
+    }
+
+    // ultimo nodo del nivel 0 con llave menor que k
+    std::shared_ptr<NodeCF<T, MaxLevel>> findPred(T k) {
+        std::shared_ptr<NodeCF<T, MaxLevel>> pred = head;
+        for (int layer = MaxLevel; layer >= 0; layer--) {
+            std::shared_ptr<NodeCF<T, MaxLevel>> curr = pred->next(layer);
+            while (curr != tail && k > curr->val) { // la cola se reconoce por identidad
+                pred = curr;
+                curr = pred->next(layer);
+            }
+        }
+        return pred;
+    }
+
+    // primer nodo del nivel 0 con llave >= k. Entre la bajada y la lectura otro hilo puede
+    // enganchar llaves menores detras de findPred: se sigue avanzando, y si el predecesor
+    // donde se paro ya estaba desenlazado se vuelve a bajar
+    std::shared_ptr<NodeCF<T, MaxLevel>> findNode(T k) {
+        while (true) {
+            std::shared_ptr<NodeCF<T, MaxLevel>> pred = findPred(k);
+            std::shared_ptr<NodeCF<T, MaxLevel>> curr = pred->next(0);
+            while (curr != tail && curr->val < k) {
+                pred = curr;
+                curr = pred->next(0);
+            }
+            if (!pred->removed)
+                return curr;
+        }
+    }
+
+    // saca del indice los nodos borrados, de arriba hacia abajo; devuelve cuantos enlaces cambio.
+    // Un nodo solo baja desde su nivel mas alto: si se borra a mitad de la pasada sigue
+    // entero en los niveles de arriba, y la pasada siguiente lo baja completo
+    size_t lowerDeleted() {
+        size_t moved = 0;
+        for (int i = MaxLevel; i >= 1; i--) {
+            std::shared_ptr<NodeCF<T, MaxLevel>> pred = head;
+            for (auto curr = head->next(i); curr != tail; curr = pred->next(i)) {
+                if (curr->deleted && curr->height == i) {
+                    pred->set_next(i, curr->next(i));
+                    curr->height = i - 1;
+                    moved++;
+                }
+                else {
+                    pred = curr;
+                }
+            }
+        }
+        return moved;
+    }
+
+    // arma cada nivel a partir del de abajo: se sube un nodo cada dos que no estan
+    // en el nivel, y se baja el que quedo pegado al anterior del mismo nivel
+    size_t rebalance(cf_stats& st) {
+        size_t moved = 0;
+        for (int i = 1; i <= MaxLevel; i++) {
+            std::shared_ptr<NodeCF<T, MaxLevel>> lastI = head;
+            int run = 0;
+            size_t below = 0;
+            for (auto x = head->next(i - 1); x != tail; x = x->next(i - 1)) {
+                below++;
+                if (x->height >= i) {
+                    if (run == 0 && lastI != head && x->height == i) {
+                        lastI->set_next(i, x->next(i));
+                        x->height = i - 1;
+                        run = 1;
+                        moved++;
+                    }
+                    else {
+                        lastI = x;
+                        run = 0;
+                    }
+                }
+                else if (++run == 2 && !x->deleted) {
+                    x->set_next(i, lastI->next(i));
+                    lastI->set_next(i, x);
+                    x->height = i;
+                    lastI = x;
+                    run = 0;
+                    moved++;
+                }
+            }
+            if (below < 2) {
+                st.index_height = i - 1;
+                break;
+            }
+            st.index_height = i;
+        }
+        return moved;
+    }
+
+    // desenlaza del nivel 0 los nodos borrados que ya no estan en el indice
+    size_t removeDeleted() {
+        size_t moved = 0;
+        std::shared_ptr<NodeCF<T, MaxLevel>> pred = head;
+        for (auto curr = head->next(0); curr != tail; curr = pred->next(0)) {
+            if (curr->deleted && curr->height == 0) {
+                pred->lock();
+                curr->lock();
+                bool valid = !pred->removed && pred->next(0) == curr && curr->deleted;
+                if (valid) {
+                    curr->removed = true;
+                    pred->set_next(0, curr->next(0));
+                    moved++;
+                }
+                curr->unlock();
+                pred->unlock();
+                if (valid)
+                    continue;
+            }
+            pred = curr;
+        }
+        return moved;
+    }
+
+    void measure(cf_stats& st) {
+        size_t gap = 0;
+        for (auto x = head->next(0); x != tail; x = x->next(0)) {
+            st.data_nodes++;
+            if (x->deleted)
+                st.pending_removal++;
+            if (x->height >= 1) {
+                st.unindexed += gap > 1 ? gap - 1 : 0;
+                gap = 0;
+            }
+            else {
+                gap++;
+            }
+        }
+        st.unindexed += gap > 1 ? gap - 1 : 0;
+    }
+
+    // duerme hasta que alguna escritura marca la lista como sucia; despues de cada pasada
+    // espera interval antes de la siguiente, asi una rafaga de escrituras no lo pone a girar
+    void maintain() {
+        unique_lock<mutex> lk(wakeMutex);
+        while (true) {
+            wake.wait(lk, [this] { return stopping || dirty.load(); });
+            if (stopping)
+                break;
+            lk.unlock();
+            dirty = false; // lo que se escriba desde aqui pide otra pasada
+            cf_stats st;
+            measure(st);
+            size_t moved = lowerDeleted();
+            moved += rebalance(st);
+            moved += removeDeleted();
+            if (moved > 0) // la pasada cambio la forma: la siguiente mide el resultado
+                dirty = true;
+            {
+                lock_guard<mutex> guard(statsMutex);
+                st.passes = last.passes + 1;
+                last = st;
+            }
+            lk.lock();
+            // si el indice iba muy atrasado se hace otra pasada de inmediato
+            if (st.unindexed <= max_unindexed)
+                wake.wait_for(lk, interval, [this] { return stopping; });
+        }
+    }
+
+public:
+    // interval: pausa minima entre pasadas de mantenimiento; sin escrituras no hay pasadas
+    // max_unindexed: atraso del indice por encima del cual no se espera entre pasadas
+    explicit skipList_cf(std::chrono::microseconds interval = std::chrono::milliseconds(1),
+        size_t max_unindexed = 1024)
+        : interval(interval), max_unindexed(max_unindexed), stopping(false), dirty(false) {
+        head = std::make_shared<NodeCF<T, MaxLevel>>(numeric_limits<T>::min());
+        tail = std::make_shared<NodeCF<T, MaxLevel>>(numeric_limits<T>::max());
+        head->height = tail->height = MaxLevel;
+        for (int i = 0; i <= MaxLevel; i++) {
+            head->set_next(i, tail);
+        }
+        maintainer = std::thread(&skipList_cf::maintain, this);
+    }
+
+    skipList_cf(const skipList_cf&) = delete;
+    skipList_cf& operator=(const skipList_cf&) = delete;
+
+    ~skipList_cf() {
+        {
+            lock_guard<mutex> guard(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        maintainer.join();
+    }
+
+    bool add(T x) {
+        while (true) {
+            std::shared_ptr<NodeCF<T, MaxLevel>> pred = findPred(x);
+            pred->lock();
+            std::shared_ptr<NodeCF<T, MaxLevel>> succ = pred->next(0);
+            if (pred->removed || (succ != tail && succ->val < x)) { // cambio mientras bajabamos
+                pred->unlock();
+                continue;
+            }
+            if (succ != tail && succ->val == x) {
+                succ->lock();
+                bool removedSucc = succ->removed;
+                bool revived = !removedSucc && succ->deleted;
+                if (revived)
+                    succ->deleted = false;
+                succ->unlock();
+                pred->unlock();
+                if (removedSucc)
+                    continue;
+                if (revived)
+                    touched();
+                return revived;
+            }
+            auto newNode = std::make_shared<NodeCF<T, MaxLevel>>(x);
+            newNode->set_next(0, succ);
+            pred->set_next(0, newNode);
+            pred->unlock();
+            touched();
+            return true;
+        }
+    }
+
+    bool remove(T x) {
+        while (true) {
+            std::shared_ptr<NodeCF<T, MaxLevel>> curr = findNode(x);
+            if (curr == tail || curr->val != x)
+                return false;
+            curr->lock();
+            if (curr->removed) {
+                curr->unlock();
+                continue;
+            }
+            bool wasLive = !curr->deleted;
+            curr->deleted = true;
+            curr->unlock();
+            if (wasLive)
+                touched();
+            return wasLive;
+        }
+    }
+
+    bool search(T x) {
+        std::shared_ptr<NodeCF<T, MaxLevel>> curr = findNode(x);
+        return curr != tail && curr->val == x && !curr->deleted;
     }
-    int lvl = (int)(log(frand()) / log(1. - P));
-    return lvl < MAX_LEVEL ? lvl : MAX_LEVEL;
-}
 
+    bool empty() {
+        for (auto curr = head->next(0); curr != tail; curr = curr->next(0)) {
+            if (!curr->deleted)
+                return false;
+        }
+        return true;
+    }
 
-template <typename Type>
-void skiplist_secuen<Type>::insert(Type val)
-{
-    node<Type>* x = header;
-    node<Type>* update[MAX_LEVEL + 1];
-    memset(update, 0, sizeof(node<Type>*) * (MAX_LEVEL + 1));
-    for (int i = level; i >= 0; i--)
-    {
-        while (x->levels[i] != NULL && x->levels[i]->value < val)
+    cf_stats stats() {
+        lock_guard<mutex> guard(statsMutex);
+        return last;
+    }
+};
+
+
+// ============================================================== EJECUTOR ASINCRONO =================================================================================
+
+// Frente asincrono para skipList_concu: un grupo fijo de hilos atiende las operaciones
+// que se le encargan, en vez de crear un hilo por operacion. Cada hilo tiene su cola;
+// las operaciones se reparten entre las colas por turno, cada hilo saca de la suya un
+// lote de hasta `batch` operaciones con un solo bloqueo, y el que se queda sin trabajo
+// le roba la mitad del final de la cola de otro. El resultado vuelve por un future o
+// por una funcion que se llama desde el hilo que ejecuto la operacion.
+// No hay orden entre operaciones pendientes: si una depende de otra, hay que esperar
+// su resultado antes de encargarla.
+
+template <typename T, int MaxLevel = MAX_LEVEL, typename Prob = P>
+class skiplist_executor {
+public:
+    typedef std::function<void(bool)> callback;
+
+private:
+    struct Task {
+        uint8_t op;
+        T key;
+        callback done;
+    };
+
+    struct Queue {
+        mutex m;
+        deque<Task> tasks;
+        char pad[64]; // cada cola en su propia linea de cache
+    };
+
+    skipList_concu<T, MaxLevel, Prob>& list; // la original, que tiene que vivir mas que el ejecutor
+    vector<unique_ptr<Queue>> queues;
+    vector<std::thread> workers;
+    size_t batch;
+    atomic<unsigned> next;
+    atomic<long long> queued;  // en alguna cola, sin que un hilo las haya tomado
+    atomic<long long> pending; // encargadas y todavia sin terminar
+    atomic<int> sleepers;
+    mutex sleepMutex;
+    condition_variable wake;
+    mutex idleMutex;
+    condition_variable idle; // pending llego a 0
+    atomic<bool> stopping;
+
+    void submit(uint8_t op, T key, callback done) {
+        Queue& q = *queues[next++ % queues.size()];
+        pending++;
+        queued++;
         {
-            x = x->levels[i];
+            lock_guard<mutex> guard(q.m);
+            q.tasks.push_back(Task{ op, key, std::move(done) });
+        }
+        if (sleepers.load() > 0) {
+            lock_guard<mutex> guard(sleepMutex);
+            wake.notify_one();
         }
-        update[i] = x;
     }
 
-    x = x->levels[0];
-    if (x == NULL || x->value != val)
-    {
-        int lvl = random_level();//asd
-        if (lvl > level)
-        {
-            for (int i = level + 1; i <= lvl; i++)
-            {
-                update[i] = header;
+    std::future<bool> submit(uint8_t op, T key) {
+        auto result = std::make_shared<std::promise<bool>>();
+        std::future<bool> f = result->get_future();
+        submit(op, key, [result](bool r) { result->set_value(r); });
+        return f;
+    }
+
+    // lote desde el frente de la cola propia
+    bool take(int id, vector<Task>& out) {
+        Queue& q = *queues[id];
+        lock_guard<mutex> guard(q.m);
+        while (!q.tasks.empty() && out.size() < batch) {
+            out.push_back(std::move(q.tasks.front()));
+            q.tasks.pop_front();
+        }
+        return !out.empty();
+    }
+
+    // la mitad del final de la primera cola ajena que tenga trabajo
+    bool steal(int id, vector<Task>& out) {
+        for (size_t i = 1; i < queues.size(); i++) {
+            Queue& q = *queues[(id + i) % queues.size()];
+            lock_guard<mutex> guard(q.m);
+            size_t half = std::min(batch, (q.tasks.size() + 1) / 2);
+            for (size_t j = 0; j < half; j++) {
+                out.push_back(std::move(q.tasks.back()));
+                q.tasks.pop_back();
             }
-            level = lvl;
+            if (!out.empty())
+                return true;
         }
-        x = new node<Type>(lvl, val);
-        for (int i = 0; i <= lvl; i++)
-        {
-            x->levels[i] = update[i]->levels[i];
-            update[i]->levels[i] = x;
+        return false;
+    }
+
+    void work(int id) {
+        vector<Task> local;
+        local.reserve(batch);
+        while (true) {
+            if (take(id, local) || steal(id, local)) {
+                queued -= local.size();
+                for (Task& t : local) {
+                    bool r;
+                    switch (t.op) {
+                    case OP_ADD: r = list.add(t.key); break;
+                    case OP_REMOVE: r = list.remove(t.key); break;
+                    default: r = list.search(t.key); break;
+                    }
+                    if (t.done)
+                        t.done(r);
+                }
+                long long n = (long long)local.size();
+                if (pending.fetch_sub(n) == n) { // era lo ultimo pendiente
+                    lock_guard<mutex> guard(idleMutex);
+                    idle.notify_all();
+                }
+                local.clear();
+                continue;
+            }
+            // se duerme solo si no queda nada en las colas; al cerrar se termina de vaciar
+            unique_lock<mutex> lk(sleepMutex);
+            sleepers++;
+            wake.wait(lk, [this]() { return queued.load() > 0 || stopping.load(); });
+            sleepers--;
+            if (stopping.load() && queued.load() == 0)
+                return;
         }
     }
-}
 
-template <typename Type>
-void skiplist_secuen<Type>::delete_(Type val)
-{
-    node<Type>* x = header;
-    node<Type>* update[MAX_LEVEL + 1];
-    memset(update, 0, sizeof(node<Type>*) * (MAX_LEVEL + 1));
-    for (int i = level; i >= 0; i--)
-    {
-        while (x->levels[i] != NULL && x->levels[i]->value < val)
+public:
+    // threads: hilos del grupo; batch: cuantas operaciones saca un hilo por bloqueo
+    explicit skiplist_executor(skipList_concu<T, MaxLevel, Prob>& list,
+        int threads = std::max(2u, std::thread::hardware_concurrency()), size_t batch = 64)
+        : list(list), batch(std::max<size_t>(1, batch)), next(0), queued(0), pending(0), sleepers(0), stopping(false) {
+        for (int i = 0; i < threads; i++)
+            queues.emplace_back(new Queue());
+        for (int i = 0; i < threads; i++)
+            workers.emplace_back(&skiplist_executor::work, this, i);
+    }
+
+    skiplist_executor(const skiplist_executor&) = delete;
+    skiplist_executor& operator=(const skiplist_executor&) = delete;
+
+    // termina lo que ya se encargo antes de cerrar
+    ~skiplist_executor() {
         {
-            x = x->levels[i];
+            lock_guard<mutex> guard(sleepMutex);
+            stopping = true;
         }
-        update[i] = x;
+        wake.notify_all();
+        for (auto& w : workers)
+            w.join();
     }
 
-    x = x->levels[0];
-    if (x->value == val)
-    {
-        for (int i = 0; i <= level; i++)
-        {
-            if (update[i]->levels[i] != x)
-                break;
-            update[i]->levels[i] = x->levels[i];
+    std::future<bool> async_add(T x) { return submit(OP_ADD, x); }
+    std::future<bool> async_search(T x) { return submit(OP_SEARCH, x); }
+    std::future<bool> async_remove(T x) { return submit(OP_REMOVE, x); }
+
+    void async_add(T x, callback done) { submit(OP_ADD, x, std::move(done)); }
+    void async_search(T x, callback done) { submit(OP_SEARCH, x, std::move(done)); }
+    void async_remove(T x, callback done) { submit(OP_REMOVE, x, std::move(done)); }
+
+    // espera a que no quede ninguna operacion pendiente
+    void wait_idle() {
+        unique_lock<mutex> lk(idleMutex);
+        idle.wait(lk, [this]() { return pending.load() == 0; });
+    }
+};
+
+
+// ============================================================== RECOLECTOR DE VENCIDOS =================================================================================
+
+// Hilo que saca de un skipList_concu las entradas vencidas. Cada pasada revisa a lo sumo
+// `visit` nodos, siguiendo donde quedo la anterior, y despues duerme `interval`; asi el
+// recolector nunca retiene mas que unos pocos candados a la vez ni ocupa un nucleo entero,
+// y las busquedas e inserciones no notan su presencia. Las busquedas no lo necesitan para
+// ignorar lo vencido, solo libera la memoria.
+
+template <typename T, int MaxLevel = MAX_LEVEL, typename Prob = P>
+class ttl_reaper {
+    skipList_concu<T, MaxLevel, Prob> list; // comparte los nodos con la lista original
+    std::chrono::microseconds interval;
+    size_t visit;
+    atomic<size_t> reaped;
+    atomic<size_t> passes;
+    mutex wakeMutex;
+    condition_variable wake;
+    bool stopping;
+    std::thread worker;
+
+    void run() {
+        T from = numeric_limits<T>::min();
+        unique_lock<mutex> lk(wakeMutex);
+        while (!stopping) {
+            lk.unlock();
+            reaped += list.reap(from, visit);
+            passes++;
+            lk.lock();
+            wake.wait_for(lk, interval);
         }
-        delete x;
-        while (level > 0 && header->levels[level] == NULL)
+    }
+
+public:
+    // interval: pausa entre pasadas; visit: nodos revisados por pasada
+    explicit ttl_reaper(const skipList_concu<T, MaxLevel, Prob>& list,
+        std::chrono::microseconds interval = std::chrono::milliseconds(1), size_t visit = 256)
+        : list(list), interval(interval), visit(std::max<size_t>(1, visit)), reaped(0), passes(0), stopping(false) {
+        worker = std::thread(&ttl_reaper::run, this);
+    }
+
+    ttl_reaper(const ttl_reaper&) = delete;
+    ttl_reaper& operator=(const ttl_reaper&) = delete;
+
+    ~ttl_reaper() {
         {
-            level--;
+            lock_guard<mutex> guard(wakeMutex);
+            stopping = true;
         }
+        wake.notify_one();
+        worker.join();
     }
-}
 
-template <typename Type>
-void skiplist_secuen<Type>::print()
+    size_t total_reaped() const { return reaped.load(); }
+
+    size_t total_passes() const { return passes.load(); }
+};
+
+
+// ============================================================== TRAZA DE CARGA =================================================================================
+
+// Una traza es la secuencia de operaciones (tipo, llave, hilo, instante) que recibio una lista.
+// Se guarda en un archivo binario compacto y se puede volver a aplicar sobre skiplist_secuen o
+// skipList_concu con una semilla fija para los niveles, asi dos corridas reciben exactamente la
+// misma entrada y se pueden comparar.
+
+struct trace_op
 {
-    cout << "\n*****Skip List*****" << "\n";
-    for (int i = 0; i <= level; i++)
+    uint8_t op;
+    uint16_t thread;
+    int32_t key;
+    uint64_t timestamp; // microsegundos desde el inicio de la traza
+};
+
+class trace_recorder
+{
+    mutex m;
+    vector<trace_op> ops;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    trace_recorder() : start(std::chrono::steady_clock::now()) {}
+
+    void record(uint8_t op, uint16_t thread, int32_t key)
     {
-        node<Type>* node = header->levels[i];
-        cout << "Nivel " << i << ": ";
-        while (node != NULL)
-        {
-            cout << node->value << " ";
-            node = node->levels[i];
-        }
-        cout << "\n";
+        uint64_t ts = duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        lock_guard<mutex> guard(m);
+        ops.push_back({ op, thread, key, ts });
     }
+
+    const vector<trace_op>& operations() const { return ops; }
+
+    bool save(const string& path) const;
 };
 
-template <typename Type>
-Type skiplist_secuen<Type>::get(Type val)
+// formato: "SKTR", version (1 byte), cantidad (8 bytes), y por operacion:
+// tipo (1 byte), hilo (2 bytes), llave (4 bytes) y el tiempo transcurrido desde
+// la operacion anterior como varint. Todo en little endian.
+static const char TRACE_MAGIC[4] = { 'S', 'K', 'T', 'R' };
+static const uint8_t TRACE_VERSION = 1;
+
+static void put_le(ostream& out, uint64_t v, int bytes)
 {
-    node<Type>* x = header;
-    for (int i = level; i >= 0; i--)
+    for (int i = 0; i < bytes; i++)
+        out.put((char)((v >> (8 * i)) & 0xff));
+}
+
+static bool get_le(istream& in, uint64_t& v, int bytes)
+{
+    v = 0;
+    for (int i = 0; i < bytes; i++) {
+        int c = in.get();
+        if (c == EOF)
+            return false;
+        v |= (uint64_t)(uint8_t)c << (8 * i);
+    }
+    return true;
+}
+
+static void put_varint(ostream& out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.put((char)((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.put((char)v);
+}
+
+static bool get_varint(istream& in, uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == EOF)
+            return false;
+        v |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool trace_recorder::save(const string& path) const
+{
+    ofstream out(path, ios::binary);
+    if (!out)
+        return false;
+    out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    put_le(out, TRACE_VERSION, 1);
+    put_le(out, ops.size(), 8);
+    uint64_t prev = 0;
+    for (const trace_op& o : ops) {
+        put_le(out, o.op, 1);
+        put_le(out, o.thread, 2);
+        put_le(out, (uint32_t)o.key, 4);
+        put_varint(out, o.timestamp - prev);
+        prev = o.timestamp;
+    }
+    return (bool)out;
+}
+
+bool load_trace(const string& path, vector<trace_op>& ops)
+{
+    ifstream in(path, ios::binary);
+    char magic[4];
+    uint64_t version, count;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)
+        return false;
+    if (!get_le(in, version, 1) || version != TRACE_VERSION || !get_le(in, count, 8))
+        return false;
+    // cada operacion ocupa al menos 8 bytes: un conteo mayor que lo que queda del archivo
+    // es una traza corrupta, no un pedido de memoria
+    streampos start = in.tellg();
+    in.seekg(0, ios::end);
+    uint64_t remaining = (uint64_t)(in.tellg() - start);
+    in.seekg(start);
+    if (!in || count > remaining / 8)
+        return false;
+    ops.clear();
+    ops.reserve((size_t)count);
+    uint64_t ts = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t op, thread, key, delta;
+        if (!get_le(in, op, 1) || !get_le(in, thread, 2) || !get_le(in, key, 4) || !get_varint(in, delta))
+            return false;
+        if (op > OP_REMOVE)
+            return false;
+        ts += delta;
+        ops.push_back({ (uint8_t)op, (uint16_t)thread, (int32_t)(uint32_t)key, ts });
+    }
+    return in.peek() == char_traits<char>::eof(); // ni operaciones de menos ni bytes de mas
+}
+
+// genera y graba una carga sintetica reproducible: n operaciones repartidas en
+// `threads` hilos, llaves uniformes en [0, key_range) y el porcentaje indicado
+// de inserciones y busquedas (el resto son borrados)
+void generate_trace(trace_recorder& rec, unsigned seed, int n, int key_range, int threads,
+    int add_pct, int search_pct)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> key(0, key_range - 1);
+    std::uniform_int_distribution<int> pct(0, 99);
+    for (int i = 0; i < n; i++) {
+        int p = pct(gen);
+        uint8_t op = p < add_pct ? OP_ADD : (p < add_pct + search_pct ? OP_SEARCH : OP_REMOVE);
+        rec.record(op, (uint16_t)(i % threads), key(gen));
+    }
+}
+
+// distribucion de Zipf sobre los rangos 0..n-1 con exponente s (tabla acumulada)
+class zipf_distribution
+{
+    vector<double> cdf;
+
+public:
+    zipf_distribution(int n, double s) : cdf(n)
     {
-        while (x->levels[i] != NULL && x->levels[i]->value <= val)
-        {
-            if (x->levels[i]->value == val) {
-                cout << "Si existe el nodo " << val << endl;
-                return x->levels[i]->value;
-            }
-            x = x->levels[i];
+        double sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += 1.0 / pow(i + 1.0, s);
+            cdf[i] = sum;
         }
     }
-    x = x->levels[0];
-    if (x != NULL && x->value == val) {
-        cout << "Si existe el nodo " << val << endl;
-        return x->value;
+
+    template <typename G>
+    int operator()(G& gen)
+    {
+        double u = std::uniform_real_distribution<double>(0, cdf.back())(gen);
+        return (int)(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
     }
-    else {
-        cout << "No existe el nodo " << val << endl;
-        return -1;
-    };
+};
+
+// n busquedas sobre las llaves [0, key_range) con popularidad Zipf(s); los rangos se
+// asignan a llaves al azar para que las llaves calientes no queden juntas
+void generate_zipf_trace(trace_recorder& rec, unsigned seed, int n, int key_range, double s)
+{
+    std::mt19937 gen(seed);
+    vector<int> keys(key_range);
+    for (int i = 0; i < key_range; i++)
+        keys[i] = i;
+    std::shuffle(keys.begin(), keys.end(), gen);
+    zipf_distribution zipf(key_range, s);
+    for (int i = 0; i < n; i++)
+        rec.record(OP_SEARCH, 0, keys[zipf(gen)]);
+}
+
+template <typename T, int M, typename R>
+void replay_op(skiplist_secuen<T, M, R>& l, const trace_op& o)
+{
+    switch (o.op) {
+    case OP_ADD: l.insert(o.key); break;
+    case OP_SEARCH: l.contains(o.key); break;
+    case OP_REMOVE: l.delete_(o.key); break;
+    }
+}
+
+template <typename T, int M, typename R>
+void replay_op(skipList_concu<T, M, R>& l, const trace_op& o)
+{
+    switch (o.op) {
+    case OP_ADD: l.add(o.key); break;
+    case OP_SEARCH: l.search(o.key); break;
+    case OP_REMOVE: l.remove(o.key); break;
+    }
+}
+
+// la lista secuencial recibe las operaciones en el orden en que se grabaron,
+// sin importar de que hilo venian. Devuelve el tiempo en ms.
+template <typename T, int M, typename R>
+long long replay(skiplist_secuen<T, M, R>& l, const vector<trace_op>& ops, unsigned seed)
+{
+    seed_levels(seed);
+    auto start = system_clock::now();
+    for (const trace_op& o : ops)
+        replay_op(l, o);
+    return duration_cast<milliseconds>(system_clock::now() - start).count();
+}
+
+template <typename T, int M, typename R>
+void replay_op(skiplist_fc<T, M, R>& l, const trace_op& o)
+{
+    switch (o.op) {
+    case OP_ADD: l.add(o.key); break;
+    case OP_SEARCH: l.search(o.key); break;
+    case OP_REMOVE: l.remove(o.key); break;
+    }
+}
+
+template <typename T, int M>
+void replay_op(skipList_cf<T, M>& l, const trace_op& o)
+{
+    switch (o.op) {
+    case OP_ADD: l.add(o.key); break;
+    case OP_SEARCH: l.search(o.key); break;
+    case OP_REMOVE: l.remove(o.key); break;
+    }
+}
+
+// las listas concurrentes reciben un hilo por cada hilo de la traza, cada uno con
+// sus operaciones en el orden original y su propia secuencia de niveles
+template <typename L>
+long long replay_threads(L& l, const vector<trace_op>& ops, unsigned seed)
+{
+    map<uint16_t, vector<trace_op>> per_thread;
+    for (const trace_op& o : ops)
+        per_thread[o.thread].push_back(o);
+
+    auto start = system_clock::now();
+    vector<thread> workers;
+    for (auto const& t : per_thread) {
+        workers.emplace_back([&l, &t, seed]() {
+            seed_levels(seed, t.first);
+            for (const trace_op& o : t.second)
+                replay_op(l, o);
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+    return duration_cast<milliseconds>(system_clock::now() - start).count();
+}
+
+template <typename T, int M, typename R>
+long long replay(skipList_concu<T, M, R>& l, const vector<trace_op>& ops, unsigned seed)
+{
+    return replay_threads(l, ops, seed);
+}
+
+template <typename T, int M, typename R>
+long long replay(skiplist_fc<T, M, R>& l, const vector<trace_op>& ops, unsigned seed)
+{
+    return replay_threads(l, ops, seed);
 }
 
+template <typename T, int M>
+long long replay(skipList_cf<T, M>& l, const vector<trace_op>& ops, unsigned seed)
+{
+    return replay_threads(l, ops, seed);
+}
+
+
 
 
 int main() {
 
+    const unsigned SEED = 2022;
+    seed_levels(SEED);
 
     // ============================================================== SKIP LIST CONCURRENTE =================================================================================
 
@@ -435,57 +2941,39 @@ int main() {
     l.empty();
     int n = 100;
 
+    // las operaciones se encargan al ejecutor en vez de crear un hilo por cada una
+    skiplist_executor<int> ex(l);
+    vector<std::future<bool>> pendientes;
 
     auto millisec_start_epoch = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-    for (int i = 1; i < n; i = i + 4) {
-        std::thread t4(&skipList_concu<int>::add, l, rand() % n);
-        std::thread t1(&skipList_concu<int>::add, l, rand() % n);
-        std::thread t2(&skipList_concu<int>::add, l, rand() % n);
-        std::thread t3(&skipList_concu<int>::add, l, rand() % n);
-        t1.detach();
-        t2.detach();
-        t3.detach();
-        t4.detach();
+    for (int i = 1; i < n; i++) {
+        pendientes.push_back(ex.async_add(rand() % n));
     }
+    for (auto& f : pendientes)
+        f.get();
     auto millisec_end_epoch = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
     cout << "Tiempo de insercion paralelo: " << millisec_end_epoch - millisec_start_epoch << " ms" << endl;
-    /*
-    l.empty();
+
+    pendientes.clear();
     millisec_start_epoch = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-    for (int i = 1; i < n; i= i +4) {
-        std::thread t1(&skipList_concu<int>::search, l, rand() % n);
-        std::thread t2(&skipList_concu<int>::search, l, rand() % n);
-        std::thread t3(&skipList_concu<int>::search, l, rand() % n);
-        std::thread t4(&skipList_concu<int>::search, l, rand() % n);
-        t1.detach();
-        t2.detach();
-        t3.detach();
-        t4.detach();
+    for (int i = 1; i < n; i++) {
+        pendientes.push_back(ex.async_search(rand() % n));
     }
+    for (auto& f : pendientes)
+        f.get();
     millisec_end_epoch = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
     cout << "Tiempo de busqueda paralelo: " << millisec_end_epoch - millisec_start_epoch << " ms" << endl;
 
-    */
-
-
-    /*
-    l.empty();
+    pendientes.clear();
     millisec_start_epoch = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-    for (int i = 1; i < n; i= i +4) {
-        std::thread t1(&skipList_concu<int>::remove, l, rand() % n);
-        std::thread t2(&skipList_concu<int>::remove, l, rand() % n);
-        std::thread t3(&skipList_concu<int>::remove, l, rand() % n);
-        std::thread t4(&skipList_concu<int>::remove, l, rand() % n);
-        t1.detach();
-        t2.detach();
-        t3.detach();
-        t4.detach();
+    for (int i = 1; i < n; i++) {
+        pendientes.push_back(ex.async_remove(rand() % n));
     }
+    for (auto& f : pendientes)
+        f.get();
     millisec_end_epoch = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
     cout << "Tiempo de borrado paralelo: " << millisec_end_epoch - millisec_start_epoch << " ms" << endl;
 
-    */
-
 
 
     // ============================================================== SKIP LIST SECUENCIAL =================================================================================
@@ -525,5 +3013,340 @@ int main() {
     */
 
 
+
+    // ============================================================== TRAZA Y REPETICION =================================================================================
+
+    // se graba una carga 60% inserciones, 30% busquedas, 10% borrados en 4 hilos y se
+    // repite sobre ambas listas con la misma semilla de niveles
+    trace_recorder rec;
+    generate_trace(rec, SEED, 100000, 10000, 4, 60, 30);
+    if (!rec.save("carga.trace")) {
+        cout << "No se pudo guardar la traza" << endl;
+        return 1;
+    }
+
+    vector<trace_op> ops;
+    if (!load_trace("carga.trace", ops)) {
+        cout << "No se pudo leer la traza" << endl;
+        return 1;
+    }
+
+    skipList_concu<int> lt;
+    cout << "Repeticion paralela (" << ops.size() << " ops): " << replay(lt, ops, SEED) << " ms" << endl;
+
+    skiplist_secuen<int> st;
+    cout << "Repeticion secuencial (" << ops.size() << " ops): " << replay(st, ops, SEED) << " ms" << endl;
+
+    // listas chicas (p.ej. indices por sesion): 16 niveles con P = 1/4
+    skipList_concu<int, 16, ratio<1, 4>> lp;
+    cout << "Repeticion paralela 16 niveles, P=1/4: " << replay(lp, ops, SEED) << " ms" << endl;
+    skiplist_secuen<int, 16, ratio<1, 4>> sp;
+    cout << "Repeticion secuencial 16 niveles, P=1/4: " << replay(sp, ops, SEED) << " ms" << endl;
+
+
+    // ============================================================== SNAPSHOTS =================================================================================
+
+    // un lector toma un snapshot y recorre el rango mientras otros hilos borran e insertan;
+    // el snapshot sigue viendo exactamente las 1000 llaves iniciales
+    skipList_concu<int> lv;
+    for (int i = 0; i < 1000; i++)
+        lv.add(i);
+    auto snap = lv.snapshot();
+    std::thread w1([&lv]() { for (int i = 0; i < 1000; i += 2) lv.remove(i); });
+    std::thread w2([&lv]() { for (int i = 1000; i < 2000; i++) lv.add(i); });
+    size_t vistos = snap->range(0, 1999).size();
+    w1.join();
+    w2.join();
+    int actuales = 0;
+    for (int i = 0; i < 2000; i++)
+        actuales += lv.search(i);
+    cout << "Snapshot v" << snap->version() << ": " << vistos << " llaves durante las escrituras, "
+        << snap->range(0, 1999).size() << " al final (lista actual: " << actuales << ")" << endl;
+    snap.reset(); // al soltarlo se desenlazan los nodos borrados que retenia
+
+
+    // ============================================================== ACCESO SESGADO (ZIPF) =================================================================================
+
+    // mismas 100000 llaves y mismas torres iniciales; 1000000 busquedas Zipf(0.99)
+    const int nz = 100000;
+    trace_recorder llaves, consultas;
+    for (int i = 0; i < nz; i++)
+        llaves.record(OP_ADD, 0, i);
+    generate_zipf_trace(consultas, SEED, 1000000, nz, 0.99);
+
+    skiplist_secuen<int> zs, za;
+    za.set_adaptive(true);
+    replay(zs, llaves.operations(), SEED);
+    replay(za, llaves.operations(), SEED);
+    cout << "Zipf secuencial estatica: " << replay(zs, consultas.operations(), SEED) << " ms" << endl;
+    cout << "Zipf secuencial adaptativa: " << replay(za, consultas.operations(), SEED) << " ms" << endl;
+
+
+    // ============================================================== ALTA CONTENCION =================================================================================
+
+    // 8 hilos, mitad inserciones y mitad borrados sobre solo 64 llaves
+    trace_recorder contencion;
+    generate_trace(contencion, SEED, 200000, 64, 8, 50, 0);
+    skipList_concu<int> lc;
+    skiplist_fc<int> lf;
+    cout << "Alta contencion, bloqueo fino: " << replay(lc, contencion.operations(), SEED) << " ms" << endl;
+    cout << "Alta contencion, flat combining: " << replay(lf, contencion.operations(), SEED) << " ms" << endl;
+
+
+    // ============================================================== SIN PUNTOS CALIENTES =================================================================================
+
+    // la misma carga de la repeticion paralela sobre la variante con indice en segundo plano
+    {
+        skipList_cf<int> lcf;
+        cout << "Repeticion paralela, indice en segundo plano: " << replay(lcf, ops, SEED) << " ms" << endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        cf_stats st = lcf.stats();
+        cout << "  nivel 0: " << st.data_nodes << " nodos, " << st.pending_removal << " borrados pendientes, "
+            << st.unindexed << " sin indexar, " << st.index_height << " niveles de indice, "
+            << st.passes << " pasadas" << endl;
+    }
+
+
+    // ============================================================== INDICE CONGELADO =================================================================================
+
+    // 1000000 busquedas uniformes sobre las 100000 llaves, con la lista normal y congelada
+    trace_recorder uniformes;
+    generate_trace(uniformes, SEED, 1000000, nz, 1, 0, 100);
+    cout << "Busqueda secuencial, lista: " << replay(zs, uniformes.operations(), SEED) << " ms" << endl;
+    if (!zs.freeze())
+        cout << "  la lista no se pudo congelar" << endl;
+    cout << "Busqueda secuencial, congelada: " << replay(zs, uniformes.operations(), SEED) << " ms" << endl;
+    cout << "  rango [500, 509] congelado: " << zs.range(500, 509).size() << " llaves" << endl;
+    zs.thaw();
+
+
+    // ============================================================== FILTRO DE AUSENTES =================================================================================
+
+    // se insertan solo las llaves pares de [0, 2 * nz) y se buscan 1000000 llaves de ese
+    // rango: la mitad son fallos repartidos por toda la lista
+    trace_recorder pares, fallos;
+    for (int i = 0; i < 2 * nz; i += 2)
+        pares.record(OP_ADD, 0, i);
+    generate_trace(fallos, SEED, 1000000, 2 * nz, 4, 0, 100);
+
+    skipList_concu<int> lz;
+    skiplist_secuen<int> sz;
+    replay(lz, pares.operations(), SEED);
+    replay(sz, pares.operations(), SEED);
+    cout << "Busqueda con fallos, paralela: " << replay(lz, fallos.operations(), SEED) << " ms" << endl;
+    cout << "Busqueda con fallos, secuencial: " << replay(sz, fallos.operations(), SEED) << " ms" << endl;
+    lz.enable_filter(nz);
+    sz.enable_filter(nz);
+    cout << "Busqueda con fallos, paralela con filtro: " << replay(lz, fallos.operations(), SEED) << " ms" << endl;
+    cout << "Busqueda con fallos, secuencial con filtro: " << replay(sz, fallos.operations(), SEED) << " ms" << endl;
+    bloom_stats bs = sz.filter_stats();
+    cout << "  filtro: " << bs.memory / 1024 << " KB, " << bs.hashes << " funciones, "
+        << bs.false_positive_rate * 100 << "% falsos positivos estimados" << endl;
+
+
+    // ============================================================== TAMANO Y MEMORIA =================================================================================
+
+    memory_stats mc = lz.memory(), ms = sz.memory();
+    cout << "Paralela: " << lz.size() << " llaves, " << mc.total() / 1024 << " KB (nodos " << mc.nodes / 1024
+        << ", torres " << mc.towers / 1024 << ", candados " << mc.locks / 1024 << ", por liberar "
+        << mc.pending_reclamation / 1024 << ", filtro " << mc.filter / 1024 << ")" << endl;
+    cout << "Secuencial: " << sz.size() << " llaves, " << ms.total() / 1024 << " KB (nodos " << ms.nodes / 1024
+        << ", torres " << ms.towers / 1024 << ", filtro " << ms.filter / 1024 << ")" << endl;
+
+
+    // ============================================================== EJECUTOR ASINCRONO =================================================================================
+
+    // la misma carga de busquedas con un hilo por operacion y con el ejecutor
+    // (respuestas por funcion, sin future)
+    const int na = 20000;
+    skipList_concu<int> la;
+    for (int i = 0; i < na; i++)
+        la.add(i);
+
+    auto ta = system_clock::now();
+    for (int i = 0; i < na; i += 4) {
+        std::thread t1(&skipList_concu<int>::search, la, i);
+        std::thread t2(&skipList_concu<int>::search, la, i + 1);
+        std::thread t3(&skipList_concu<int>::search, la, i + 2);
+        std::thread t4(&skipList_concu<int>::search, la, i + 3);
+        t1.join();
+        t2.join();
+        t3.join();
+        t4.join();
+    }
+    cout << "Busquedas con un hilo por operacion: " << duration_cast<milliseconds>(system_clock::now() - ta).count() << " ms" << endl;
+
+    atomic<int> encontradas(0);
+    {
+        skiplist_executor<int> ea(la);
+        ta = system_clock::now();
+        for (int i = 0; i < na; i++)
+            ea.async_search(i, [&encontradas](bool r) { if (r) encontradas++; });
+        ea.wait_idle();
+        cout << "Busquedas con el ejecutor: " << duration_cast<milliseconds>(system_clock::now() - ta).count() << " ms ("
+            << encontradas << " encontradas)" << endl;
+    }
+
+
+    // ============================================================== VENCIMIENTOS =================================================================================
+
+    // indice por tiempo: la mitad de las entradas vence a los 50 ms. Apenas vencen las
+    // busquedas dejan de verlas; el recolector las va sacando de a poco mientras se sigue buscando
+    const int nt = 50000;
+    skipList_concu<int> lx;
+    auto vence = ttl_clock::now() + std::chrono::milliseconds(50);
+    int renovadas = 0;
+    for (int i = 0; i < nt; i++) {
+        if (i % 2 == 0)
+            lx.add(i, vence);
+        else
+            lx.add(i);
+        // add no renueva una llave viva: las 100 primeras con vencimiento se renuevan aparte
+        if (i % 2 == 0 && i < 200)
+            renovadas += lx.expire_at(i, ttl_clock::time_point::max());
+    }
+    this_thread::sleep_until(vence);
+    int vistas = 0;
+    for (int i = 0; i < nt; i += 2)
+        vistas += lx.search(i);
+    cout << "Vencidas visibles: " << vistas - renovadas << " de " << nt / 2 - renovadas << " (" << renovadas
+        << " renovadas), llaves sin recolectar: " << lx.size() << endl;
+    {
+        ttl_reaper<int> rx(lx, std::chrono::microseconds(200), 512);
+        ta = system_clock::now();
+        while (lx.size() > (size_t)(nt / 2 + renovadas)) {
+            for (int i = 1; i < nt; i += 2)
+                lx.search(i);
+        }
+        cout << "Recoleccion paralela con busquedas: " << duration_cast<milliseconds>(system_clock::now() - ta).count()
+            << " ms, " << rx.total_reaped() << " recolectadas en " << rx.total_passes() << " pasadas" << endl;
+    }
+
+    skiplist_secuen<int> sx;
+    vence = ttl_clock::now() + std::chrono::milliseconds(50);
+    for (int i = 0; i < nt; i++) {
+        if (i % 2 == 0)
+            sx.insert(i, vence);
+        else
+            sx.insert(i);
+    }
+    this_thread::sleep_until(vence);
+    sx.set_reap_budget(64);
+    ta = system_clock::now();
+    for (int i = nt; sx.size() > (size_t)nt / 2 + (i - nt); i++)
+        sx.insert(i);
+    cout << "Recoleccion secuencial repartida en inserciones: " << duration_cast<milliseconds>(system_clock::now() - ta).count()
+        << " ms, quedan " << sx.size() << " llaves" << endl;
+
+
+    // ============================================================== MODO MAPA =================================================================================
+
+    // valores guardados en el mismo nodo que la llave, contra el conjunto con un map aparte
+    // (dos busquedas por consulta)
+    const int nm = 100000;
+    skiplist_secuen<int, MAX_LEVEL, P, string> sm;
+    skiplist_secuen<int> sk;
+    map<int, string> aparte;
+    for (int i = 0; i < nm; i++) {
+        sm.try_emplace(i, 16, (char)('a' + i % 26)); // el string se construye dentro del nodo
+        sk.insert(i);
+        aparte.emplace(i, string(16, (char)('a' + i % 26)));
+    }
+    vector<int> pedidas(nm);
+    std::mt19937 gm(SEED);
+    for (int i = 0; i < nm; i++)
+        pedidas[i] = gm() % nm;
+    size_t largo = 0;
+    ta = system_clock::now();
+    for (int i = 0; i < nm; i++) {
+        const string* v = sm.find_value(pedidas[i]);
+        largo += v != NULL ? v->size() : 0;
+    }
+    cout << "Mapa secuencial, una busqueda: " << duration_cast<milliseconds>(system_clock::now() - ta).count() << " ms" << endl;
+    ta = system_clock::now();
+    for (int i = 0; i < nm; i++) {
+        int k = pedidas[i];
+        if (sk.contains(k))
+            largo += aparte.find(k)->second.size();
+    }
+    cout << "Conjunto con map aparte: " << duration_cast<milliseconds>(system_clock::now() - ta).count() << " ms" << endl;
+
+    // valores que solo se pueden mover
+    skiplist_secuen<int, MAX_LEVEL, P, unique_ptr<string>> su;
+    su.try_emplace(1, new string("uno"));
+    su.insert_or_assign(1, unique_ptr<string>(new string("otro uno")));
+    cout << "Valor movible de 1: " << *su.insert_or_assign(2, unique_ptr<string>(new string("dos"))).first << ", "
+        << **su.find_value(1) << endl;
+
+    // en la paralela, un hilo reemplaza los valores mientras otros los leen, sin desenlazar nodos
+    skipList_concu<int, MAX_LEVEL, P, string> cm;
+    for (int i = 0; i < 1000; i++)
+        cm.emplace(i, "v0");
+    {
+        vector<std::thread> hilos;
+        atomic<size_t> leido(0);
+        hilos.emplace_back([&cm]() {
+            for (int r = 1; r <= 100; r++)
+                for (int i = 0; i < 1000; i++)
+                    cm.insert_or_assign(i, "v" + to_string(r));
+        });
+        for (int t = 0; t < 2; t++) {
+            hilos.emplace_back([&cm, &leido]() {
+                size_t suma = 0; // cada hilo suma aparte y publica una sola vez
+                for (int r = 0; r < 100; r++)
+                    for (int i = 0; i < 1000; i++)
+                        suma += cm.get(i)->size();
+                leido += suma;
+            });
+        }
+        for (auto& h : hilos)
+            h.join();
+        largo += leido;
+    }
+    cout << "Mapa paralelo: " << cm.size() << " llaves, valor de 7: " << *cm.get(7) << endl;
+
+
+    // ============================================================== MODO CONTEO =================================================================================
+
+    // el flujo Zipf de antes como eventos repetidos: un nodo por llave distinta con su contador
+    skiplist_secuen<int, MAX_LEVEL, P, occurrence_count> sc;
+    ta = system_clock::now();
+    for (const trace_op& o : consultas.operations())
+        sc.increment(o.key);
+    cout << "Conteo secuencial: " << duration_cast<milliseconds>(system_clock::now() - ta).count() << " ms, "
+        << sc.size() << " llaves distintas para " << consultas.operations().size() << " eventos" << endl;
+
+    // 4 hilos cuentan cada uno un cuarto del flujo; las llaves que ya estan se suman sin candados
+    skipList_concu<int, MAX_LEVEL, P, occurrence_count> lconteo;
+    const vector<trace_op>& eventos = consultas.operations();
+    ta = system_clock::now();
+    {
+        vector<std::thread> hilos;
+        for (int t = 0; t < 4; t++) {
+            hilos.emplace_back([&lconteo, &eventos, t, SEED]() {
+                seed_levels(SEED, t);
+                for (size_t i = t; i < eventos.size(); i += 4)
+                    lconteo.increment(eventos[i].key);
+            });
+        }
+        for (auto& h : hilos)
+            h.join();
+    }
+    long long ms_conteo = duration_cast<milliseconds>(system_clock::now() - ta).count();
+    size_t total = 0, mas_frecuente = 0;
+    int llave_frecuente = 0;
+    for (int i = 0; i < nz; i++) {
+        size_t c = lconteo.occurrences(i);
+        total += c;
+        if (c > mas_frecuente) {
+            mas_frecuente = c;
+            llave_frecuente = i;
+        }
+    }
+    cout << "Conteo paralelo: " << ms_conteo << " ms, "
+        << lconteo.size() << " llaves distintas, " << total << " eventos, la mas frecuente (" << llave_frecuente
+        << ") aparece " << mas_frecuente << " veces (secuencial: " << sc.occurrences(llave_frecuente) << ")" << endl;
+
+
     return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file